@@ -8,6 +8,10 @@ Texture2D gGlossinessMap : GlossinessMap;
 float4x4  gWorldMatrix : WORLD;
 float3    gCameraPosition : CAMERA;
 
+// Shared by every vertex of a mesh in the compact format (COMPACT_VERTICES)
+float2    gTexCoordOffset : TEXCOORDOFFSET;
+float2    gTexCoordRange : TEXCOORDRANGE;
+
 static const float3 LightDirection = float3(0.577f, -0.577f, 0.577f);
 static const float LightIntensity = float(7.0f);
 static const float Shininess = float(25.0f);
@@ -56,6 +60,15 @@ SamplerState AnisotropicSampler
 };
 
 // Input/Output structs
+#ifdef COMPACT_VERTICES
+struct VS_INPUT {
+	float3 Position : POSITION;
+	float2 TextureUV : TEXCOORD; // 16 bit unorm inside of the texture coordinate range of the mesh
+	float2 Normal : NORMAL;      // 16 bit snorm octahedral
+	float2 Tangent : TANGENT;    // 16 bit snorm octahedral
+	float4 Color : COLOR;        // 8 bit unorm, the same for every vertex when the mesh has a uniform color
+};
+#else
 struct VS_INPUT {
 	float3 Position : POSITION;
 	float3 Color : COLOR;
@@ -63,6 +76,7 @@ struct VS_INPUT {
 	float3 Normal : NORMAL;
 	float3 Tangent : TANGENT;
 };
+#endif
 
 struct VS_OUTPUT {
 	float4 Position : SV_POSITION;
@@ -73,15 +87,36 @@ struct VS_OUTPUT {
 	float3 Tangent : TANGENT;
 };
 
+// Unfolds a direction stored on the octahedron |x| + |y| + |z| = 1
+float3 DecodeOctahedral(float2 encoded)
+{
+	float3 direction = float3(encoded, 1.f - abs(encoded.x) - abs(encoded.y));
+	float fold = saturate(-direction.z);
+	direction.xy -= (encoded >= 0.f ? fold : -fold);
+	return direction;
+}
+
 // Vertex shader
 VS_OUTPUT VS(VS_INPUT input) {
+#ifdef COMPACT_VERTICES
+	float3 color = input.Color.rgb;
+	float2 textureUV = gTexCoordOffset + input.TextureUV * gTexCoordRange;
+	float3 normal = DecodeOctahedral(input.Normal);
+	float3 tangent = DecodeOctahedral(input.Tangent);
+#else
+	float3 color = input.Color;
+	float2 textureUV = input.TextureUV;
+	float3 normal = input.Normal;
+	float3 tangent = input.Tangent;
+#endif
+
 	VS_OUTPUT output = (VS_OUTPUT)0;
 	output.Position = mul(float4(input.Position, 1.f), gWorldViewProj);
 	output.WorldPosition = mul(float4(input.Position, 1.f), gWorldMatrix);
-	output.Diffuse = float4(input.Color, 1.0f);
-	output.TextureUV = input.TextureUV;
-	output.Normal = normalize(mul(normalize(input.Normal), (float3x3) gWorldMatrix));
-	output.Tangent = normalize(mul(normalize(input.Tangent), (float3x3) gWorldMatrix));
+	output.Diffuse = float4(color, 1.0f);
+	output.TextureUV = textureUV;
+	output.Normal = normalize(mul(normalize(normal), (float3x3) gWorldMatrix));
+	output.Tangent = normalize(mul(normalize(tangent), (float3x3) gWorldMatrix));
 	return output;
 }
 
@@ -0,0 +1,118 @@
+#include "AttributeSetup.h"
+
+namespace dae
+{
+	AttributeSetup::Plane AttributeSetup::CreatePlane(const Plane(&weights)[3], float value0, float value1, float value2)
+	{
+		return {
+			weights[0].origin * value0 + weights[1].origin * value1 + weights[2].origin * value2,
+			weights[0].stepX * value0 + weights[1].stepX * value1 + weights[2].stepX * value2,
+			weights[0].stepY * value0 + weights[1].stepY * value1 + weights[2].stepY * value2
+		};
+	}
+
+	void AttributeSetup::Setup(const OutVertex& v0, const OutVertex& v1, const OutVertex& v2, const Plane(&weights)[3], uint8_t varyings, Planes& planes)
+	{
+		const float inverseW0{ v0.position.w };
+		const float inverseW1{ v1.position.w };
+		const float inverseW2{ v2.position.w };
+
+		if (varyings & (uvVarying | worldPositionVarying)) {
+			planes.inverseW = CreatePlane(weights, inverseW0, inverseW1, inverseW2);
+		}
+
+		if (varyings & uvVarying) {
+			for (int component{}; component < 2; ++component) {
+				planes.uv[component] = CreatePlane(weights, v0.uv[component] * inverseW0, v1.uv[component] * inverseW1, v2.uv[component] * inverseW2);
+			}
+		}
+
+		for (int component{}; component < 3; ++component) {
+			if (varyings & worldPositionVarying) {
+				planes.worldPosition[component] = CreatePlane(weights,
+					v0.worldPosition[component] * inverseW0, v1.worldPosition[component] * inverseW1, v2.worldPosition[component] * inverseW2);
+			}
+
+			if (varyings & normalVarying) {
+				planes.normal[component] = CreatePlane(weights, v0.normal[component], v1.normal[component], v2.normal[component]);
+			}
+
+			if (varyings & tangentVarying) {
+				planes.tangent[component] = CreatePlane(weights, v0.tangent[component], v1.tangent[component], v2.tangent[component]);
+			}
+		}
+	}
+
+	AttributeSetup::Fragment AttributeSetup::Interpolate(const Planes& planes, float x, float y, uint8_t varyings)
+	{
+		Fragment fragment{};
+
+		if (varyings & (uvVarying | worldPositionVarying)) {
+			const float interpolatedW{ 1 / planes.inverseW.At(x, y) };
+
+			if (varyings & uvVarying) {
+				fragment.uv = { planes.uv[0].At(x, y) * interpolatedW, planes.uv[1].At(x, y) * interpolatedW };
+			}
+
+			if (varyings & worldPositionVarying) {
+				fragment.worldPosition = {
+					planes.worldPosition[0].At(x, y) * interpolatedW,
+					planes.worldPosition[1].At(x, y) * interpolatedW,
+					planes.worldPosition[2].At(x, y) * interpolatedW
+				};
+			}
+		}
+
+		if (varyings & normalVarying) {
+			fragment.normal = Vector3{ planes.normal[0].At(x, y), planes.normal[1].At(x, y), planes.normal[2].At(x, y) }.Normalized();
+		}
+
+		if (varyings & tangentVarying) {
+			fragment.tangent = Vector3{ planes.tangent[0].At(x, y), planes.tangent[1].At(x, y), planes.tangent[2].At(x, y) }.Normalized();
+		}
+
+		return fragment;
+	}
+
+	void AttributeSetup::GetTexCoordDerivatives(const Planes& planes, float quadX, float quadY, Vector2& ddx, Vector2& ddy)
+	{
+		const auto getTexCoord = [&planes](float x, float y) {
+			const float interpolatedW{ 1 / planes.inverseW.At(x, y) };
+			return Vector2{ planes.uv[0].At(x, y) * interpolatedW, planes.uv[1].At(x, y) * interpolatedW };
+		};
+
+		const Vector2 topLeft{ getTexCoord(quadX, quadY) };
+		ddx = getTexCoord(quadX + 1, quadY) - topLeft;
+		ddy = getTexCoord(quadX, quadY + 1) - topLeft;
+	}
+
+	AttributeSetup::Fragment AttributeSetup::InterpolateWeights(const OutVertex& v0, const OutVertex& v1, const OutVertex& v2, float weight0, float weight1, float weight2, uint8_t varyings)
+	{
+		Fragment fragment{};
+
+		if (varyings & (uvVarying | worldPositionVarying)) {
+			const float interpolatedW{ 1 / ((weight0 * v0.position.w) + (weight1 * v1.position.w) + (weight2 * v2.position.w)) };
+			const float perspectiveWeight0{ weight0 * v0.position.w * interpolatedW };
+			const float perspectiveWeight1{ weight1 * v1.position.w * interpolatedW };
+			const float perspectiveWeight2{ weight2 * v2.position.w * interpolatedW };
+
+			if (varyings & uvVarying) {
+				fragment.uv = v0.uv * perspectiveWeight0 + v1.uv * perspectiveWeight1 + v2.uv * perspectiveWeight2;
+			}
+
+			if (varyings & worldPositionVarying) {
+				fragment.worldPosition = v0.worldPosition * perspectiveWeight0 + v1.worldPosition * perspectiveWeight1 + v2.worldPosition * perspectiveWeight2;
+			}
+		}
+
+		if (varyings & normalVarying) {
+			fragment.normal = (v0.normal * weight0 + v1.normal * weight1 + v2.normal * weight2).Normalized();
+		}
+
+		if (varyings & tangentVarying) {
+			fragment.tangent = (v0.tangent * weight0 + v1.tangent * weight1 + v2.tangent * weight2).Normalized();
+		}
+
+		return fragment;
+	}
+}
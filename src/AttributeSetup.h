@@ -0,0 +1,72 @@
+#pragma once
+
+//Standard includes
+#include <cstdint>
+
+//Project includes
+#include "Mesh.h"
+#include "Vector2.h"
+#include "Vector3.h"
+
+namespace dae
+{
+	// Turns the attributes of a triangle into planes over the screen, once per triangle
+	// A pixel then evaluates every attribute with a few multiply adds, perspective correction costs a single reciprocal
+	namespace AttributeSetup
+	{
+		// Attributes a fragment interpolates, only the ones the active view and shading mode read get set up
+		enum Varying : uint8_t {
+			uvVarying = 1 << 0,
+			normalVarying = 1 << 1,
+			tangentVarying = 1 << 2,
+			worldPositionVarying = 1 << 3
+		};
+
+		// Value at pixel center (x, y), relative to the anchor pixel of the triangle so the origin stays small
+		struct Plane {
+			float origin;
+			float stepX;
+			float stepY;
+
+			float At(float x, float y) const
+			{
+				return origin + stepX * x + stepY * y;
+			}
+		};
+
+		// The barycentric weights of the vertices are planes too, any other plane is their weighted sum
+		Plane CreatePlane(const Plane(&weights)[3], float value0, float value1, float value2);
+
+		// Uv and world position are divided by w, the interpolated w gets them back per pixel
+		// Normals and tangents are interpolated in screen space and normalized per pixel
+		struct Planes {
+			Plane inverseW;
+			Plane uv[2];
+			Plane worldPosition[3];
+			Plane normal[3];
+			Plane tangent[3];
+		};
+
+		// Interpolated attributes of a pixel, the ones not in the varyings are left at zero
+		struct Fragment {
+			Vector2 uv;
+			// Change of the uv over the 2x2 quad of the pixel, for picking mip levels
+			Vector2 uvDdx;
+			Vector2 uvDdy;
+			Vector3 normal;
+			Vector3 tangent;
+			Vector3 worldPosition;
+		};
+
+		// Vertex positions hold 1 / w, as the vertex stage outputs them
+		void Setup(const OutVertex& v0, const OutVertex& v1, const OutVertex& v2, const Plane(&weights)[3], uint8_t varyings, Planes& planes);
+		Fragment Interpolate(const Planes& planes, float x, float y, uint8_t varyings);
+
+		// Differences of the uv between the top left pixel (quadX, quadY) of a quad and its neighbours to the right and below
+		// Every pixel of the quad gets the same derivatives, like the coarse derivatives of a GPU
+		void GetTexCoordDerivatives(const Planes& planes, float quadX, float quadY, Vector2& ddx, Vector2& ddy);
+
+		// Reference with weighted sums of the vertex attributes at every pixel, how the rasterizer used to interpolate
+		Fragment InterpolateWeights(const OutVertex& v0, const OutVertex& v1, const OutVertex& v2, float weight0, float weight1, float weight2, uint8_t varyings);
+	}
+}
@@ -1,7 +1,7 @@
 #include "BaseEffect.h"
 
-BaseEffect::BaseEffect(ID3D11Device* pDevice, const std::wstring& assetFile) : m_pDevice(pDevice) {
-	m_pEffect = LoadEffect(pDevice, assetFile);
+BaseEffect::BaseEffect(ID3D11Device* pDevice, const std::wstring& assetFile, VertexFormat vertexFormat) : m_pDevice(pDevice), m_VertexFormat(vertexFormat) {
+	m_pEffect = LoadEffect(pDevice, assetFile, vertexFormat);
 
 	m_pPointTechnique = m_pEffect->GetTechniqueByName("PointTechnique");
 	if (!m_pPointTechnique->IsValid()) {
@@ -32,6 +32,18 @@ BaseEffect::BaseEffect(ID3D11Device* pDevice, const std::wstring& assetFile) : m
 	}
 
   m_pRasterizerVariable->GetRasterizerState(0, &m_pRasterizerState);
+
+	if (m_VertexFormat == VertexFormat::Compact) {
+		m_pTexCoordOffsetVariable = m_pEffect->GetVariableByName("gTexCoordOffset")->AsVector();
+		if (!m_pTexCoordOffsetVariable->IsValid()) {
+			std::wcout << L"m_pTexCoordOffsetVariable is not valid!\n";
+		}
+
+		m_pTexCoordRangeVariable = m_pEffect->GetVariableByName("gTexCoordRange")->AsVector();
+		if (!m_pTexCoordRangeVariable->IsValid()) {
+			std::wcout << L"m_pTexCoordRangeVariable is not valid!\n";
+		}
+	}
 }
 
 BaseEffect::~BaseEffect() {
@@ -63,6 +75,14 @@ BaseEffect::~BaseEffect() {
 		m_pWorldMatrixVariable->Release();
 	}
 
+	if (m_pTexCoordOffsetVariable) {
+		m_pTexCoordOffsetVariable->Release();
+	}
+
+	if (m_pTexCoordRangeVariable) {
+		m_pTexCoordRangeVariable->Release();
+	}
+
 	if (m_pPointTechnique) {
 		m_pPointTechnique->Release();
 	}
@@ -96,6 +116,10 @@ ID3D11InputLayout* BaseEffect::GetInputLayout() const {
 	return m_pInputLayout;
 }
 
+BaseEffect::VertexFormat BaseEffect::GetVertexFormat() const {
+	return m_VertexFormat;
+}
+
 void BaseEffect::SetWorldMatrixVariable(dae::Matrix& matrix) {
 	if (m_pWorldMatrixVariable) {
 		m_pWorldMatrixVariable->SetMatrix(reinterpret_cast<float*>(&matrix));
@@ -128,7 +152,7 @@ ID3DX11EffectTechnique* BaseEffect::GetTechnique(TechniqueType type) const {
 	}
 }
 
-ID3DX11Effect* BaseEffect::LoadEffect(ID3D11Device* pDevice, const std::wstring& assetFile) {
+ID3DX11Effect* BaseEffect::LoadEffect(ID3D11Device* pDevice, const std::wstring& assetFile, VertexFormat vertexFormat) {
 	HRESULT result;
 	ID3D10Blob* pErrorBlob{ nullptr };
 	ID3DX11Effect* pEffect;
@@ -140,7 +164,11 @@ ID3DX11Effect* BaseEffect::LoadEffect(ID3D11Device* pDevice, const std::wstring&
 	shaderFlags |= D3DCOMPILE_SKIP_OPTIMIZATION;
 #endif
 
-	result = D3DX11CompileEffectFromFile(assetFile.c_str(), nullptr, nullptr, shaderFlags, 0, pDevice, &pEffect, &pErrorBlob);
+	// The shader picks its vertex input through the preprocessor
+	const D3D_SHADER_MACRO compactDefines[]{ { "COMPACT_VERTICES", "1" }, { nullptr, nullptr } };
+	const D3D_SHADER_MACRO* pDefines{ vertexFormat == VertexFormat::Compact ? compactDefines : nullptr };
+
+	result = D3DX11CompileEffectFromFile(assetFile.c_str(), pDefines, nullptr, shaderFlags, 0, pDevice, &pEffect, &pErrorBlob);
 
 	if (FAILED(result)) {
 		if (pErrorBlob != nullptr) {
@@ -175,25 +203,37 @@ void BaseEffect::SetWorldViewProjectionVariable(dae::Matrix& matrix) {
 
 void BaseEffect::SetDiffuseMap(std::shared_ptr<dae::Texture>& pDiffuseTexture) {
 	if (m_pDiffuseMapVariable) {
-		m_pDiffuseMapVariable->SetResource(pDiffuseTexture->GetSRV());
+		m_pDiffuseMapVariable->SetResource(pDiffuseTexture ? pDiffuseTexture->GetSRV() : nullptr);
 	}
 }
 
 void BaseEffect::SetNormalMap(std::shared_ptr<dae::Texture>& pNormalTexture) {
 	if (m_pNormalMapVariable) {
-		m_pNormalMapVariable->SetResource(pNormalTexture->GetSRV());
+		m_pNormalMapVariable->SetResource(pNormalTexture ? pNormalTexture->GetSRV() : nullptr);
 	}
 }
 
 void BaseEffect::SetSpecularMap(std::shared_ptr<dae::Texture>& pSpecularTexture) {
 	if (m_pSpecularMapVariable) {
-		m_pSpecularMapVariable->SetResource(pSpecularTexture->GetSRV());
+		m_pSpecularMapVariable->SetResource(pSpecularTexture ? pSpecularTexture->GetSRV() : nullptr);
 	}
 }
 
 void BaseEffect::SetGlossinessMap(std::shared_ptr<dae::Texture>& pGlossinessTexture) {
 	if (m_pGlossinessMapVariable) {
-		m_pGlossinessMapVariable->SetResource(pGlossinessTexture->GetSRV());
+		m_pGlossinessMapVariable->SetResource(pGlossinessTexture ? pGlossinessTexture->GetSRV() : nullptr);
+	}
+}
+
+void BaseEffect::SetCompactVertexConstants(const dae::Vector2& texCoordOffset, const dae::Vector2& texCoordRange) {
+	if (m_pTexCoordOffsetVariable) {
+		const float offset[4]{ texCoordOffset.x, texCoordOffset.y };
+		m_pTexCoordOffsetVariable->SetFloatVector(offset);
+	}
+
+	if (m_pTexCoordRangeVariable) {
+		const float range[4]{ texCoordRange.x, texCoordRange.y };
+		m_pTexCoordRangeVariable->SetFloatVector(range);
 	}
 }
 
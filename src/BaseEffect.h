@@ -19,6 +19,12 @@ public:
 		Anisotropic
 	};
 
+	// Layout of the vertex buffer, the effect gets compiled with COMPACT_VERTICES defined for the compact one
+	enum class VertexFormat {
+		Full,
+		Compact
+	};
+
 	virtual ~BaseEffect();
 
 	// Effects should not be copied
@@ -28,6 +34,7 @@ public:
 	BaseEffect& operator=(BaseEffect&&) noexcept = default;
 
 	ID3D11InputLayout* GetInputLayout() const;
+	VertexFormat GetVertexFormat() const;
 
 	void SetWorldMatrixVariable(dae::Matrix& matrix);
 	void SetCameraPositionVariable(dae::Vector3& position);
@@ -36,15 +43,18 @@ public:
 	void SetNormalMap(std::shared_ptr<dae::Texture>& pNormalTexture);
 	void SetSpecularMap(std::shared_ptr<dae::Texture>& pSpecularTexture);
 	void SetGlossinessMap(std::shared_ptr<dae::Texture>& pGlossinessTexture);
+	// Decoding of the texture coordinates (offset + value * range) of a compact mesh
+	void SetCompactVertexConstants(const dae::Vector2& texCoordOffset, const dae::Vector2& texCoordRange);
 
 	void SetCullMode(D3D11_CULL_MODE mode);
 
 	ID3DX11Effect* GetEffect() const;
 	ID3DX11EffectTechnique* GetTechnique(TechniqueType type) const;
 protected:
-	BaseEffect(ID3D11Device* pDevice, const std::wstring& assetFile);
+	BaseEffect(ID3D11Device* pDevice, const std::wstring& assetFile, VertexFormat vertexFormat = VertexFormat::Full);
 
 	ID3D11Device* m_pDevice{ nullptr };
+	VertexFormat m_VertexFormat{ VertexFormat::Full };
 
 	ID3DX11Effect* m_pEffect{ nullptr };
 
@@ -64,8 +74,12 @@ protected:
 
 	ID3DX11EffectVectorVariable* m_pCameraPositionVariable{ nullptr };
 	ID3DX11EffectMatrixVariable* m_pWorldMatrixVariable{ nullptr };
+
+	// Only set for the compact vertex format
+	ID3DX11EffectVectorVariable* m_pTexCoordOffsetVariable{ nullptr };
+	ID3DX11EffectVectorVariable* m_pTexCoordRangeVariable{ nullptr };
 	
 	ID3D11InputLayout* m_pInputLayout{ nullptr };
 private:
-	static ID3DX11Effect* LoadEffect(ID3D11Device* pDevice, const std::wstring& assetFile);
+	static ID3DX11Effect* LoadEffect(ID3D11Device* pDevice, const std::wstring& assetFile, VertexFormat vertexFormat);
 };
\ No newline at end of file
@@ -0,0 +1,1024 @@
+#include "Benchmark.h"
+
+//Standard includes
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <SDL.h>
+
+//Project includes
+#include "AttributeSetup.h"
+#include "PixelLayout.h"
+#include "Camera.h"
+#include "Material.h"
+#include "Mesh.h"
+#include "SoftwareRenderBackend.h"
+#include "Texture.h"
+#include "ThreadPool.h"
+#include "Utils.h"
+#include "VertexStage.h"
+
+namespace dae
+{
+	namespace
+	{
+		// Repeats of every measurement, the fastest one is reported
+		constexpr int PASS_COUNT{ 8 };
+
+		// Tile and block sizes used by the binned block rasterizer
+		constexpr int BIN_SIZE{ 64 };
+		constexpr int HIZ_TILE_SIZE{ 8 };
+		constexpr int BLOCK_WIDTH{ 4 };
+		constexpr int BLOCK_HEIGHT{ 2 };
+
+		struct Resolution {
+			const char* name;
+			int width;
+			int height;
+		};
+
+		// Depth test and write of a single pixel, every pass is nearer than the last so all of them write
+		template <typename IndexFunction>
+		void TestDepth(std::vector<float>& depthBuffer, const IndexFunction& getIndex, int px, int py, float depth)
+		{
+			float& storedDepth{ depthBuffer[getIndex(px, py)] };
+			if (depth < storedDepth) {
+				storedDepth = depth;
+			}
+		}
+
+		// Walks the screen like one huge triangle in the immediate renderer, a row at a time
+		template <typename IndexFunction>
+		void ScanlinePass(std::vector<float>& depthBuffer, const IndexFunction& getIndex, int width, int height, float depth)
+		{
+			for (int py{}; py < height; ++py) {
+				for (int px{}; px < width; ++px) {
+					TestDepth(depthBuffer, getIndex, px, py, depth);
+				}
+			}
+		}
+
+		// Walks the screen like the binned renderer, bins hold Hi-Z tiles which hold 4x2 blocks
+		template <typename IndexFunction>
+		void BlockPass(std::vector<float>& depthBuffer, const IndexFunction& getIndex, int width, int height, float depth)
+		{
+			for (int binY{}; binY < height; binY += BIN_SIZE) {
+				for (int binX{}; binX < width; binX += BIN_SIZE) {
+					for (int tileY{ binY }; tileY < std::min(binY + BIN_SIZE, height); tileY += HIZ_TILE_SIZE) {
+						for (int tileX{ binX }; tileX < std::min(binX + BIN_SIZE, width); tileX += HIZ_TILE_SIZE) {
+							const int tileEndX{ std::min(tileX + HIZ_TILE_SIZE, width) };
+							const int tileEndY{ std::min(tileY + HIZ_TILE_SIZE, height) };
+
+							for (int blockY{ tileY }; blockY < tileEndY; blockY += BLOCK_HEIGHT) {
+								for (int blockX{ tileX }; blockX < tileEndX; blockX += BLOCK_WIDTH) {
+									for (int py{ blockY }; py < std::min(blockY + BLOCK_HEIGHT, tileEndY); ++py) {
+										for (int px{ blockX }; px < std::min(blockX + BLOCK_WIDTH, tileEndX); ++px) {
+											TestDepth(depthBuffer, getIndex, px, py, depth);
+										}
+									}
+								}
+							}
+						}
+					}
+				}
+			}
+		}
+
+		// Returns the fastest pass in milliseconds, the pass gets its index
+		template <typename Pass>
+		double BestTime(const Pass& pass)
+		{
+			double bestTime{ DBL_MAX };
+			for (int passIndex{}; passIndex < PASS_COUNT; ++passIndex) {
+				const auto start{ std::chrono::steady_clock::now() };
+				pass(passIndex);
+				const auto end{ std::chrono::steady_clock::now() };
+
+				bestTime = std::min(bestTime, std::chrono::duration<double, std::milli>(end - start).count());
+			}
+
+			return bestTime;
+		}
+
+		// Returns the fastest pass in milliseconds
+		template <typename Pass>
+		double Measure(std::vector<float>& depthBuffer, const Pass& pass)
+		{
+			std::fill(depthBuffer.begin(), depthBuffer.end(), FLT_MAX);
+
+			return BestTime([&pass](int passIndex) { pass(1.f - static_cast<float>(passIndex) / PASS_COUNT); });
+		}
+
+		template <typename IndexFunction>
+		void MeasureLayout(const Resolution& resolution, const char* layoutName, size_t bufferSize, const IndexFunction& getIndex)
+		{
+			std::vector<float> depthBuffer(bufferSize);
+
+			const int width{ resolution.width };
+			const int height{ resolution.height };
+
+			const double scanlineTime{ Measure(depthBuffer, [&](float depth) { ScanlinePass(depthBuffer, getIndex, width, height, depth); }) };
+			const double blockTime{ Measure(depthBuffer, [&](float depth) { BlockPass(depthBuffer, getIndex, width, height, depth); }) };
+
+			// Every pixel gets read and written once per pass
+			const double bytesPerPass{ static_cast<double>(width) * height * sizeof(float) * 2 };
+			const auto bandwidth = [bytesPerPass](double milliseconds) { return bytesPerPass / (milliseconds * 1e6); };
+
+			std::cout << "    " << std::left << std::setw(24) << layoutName << std::right << std::fixed << std::setprecision(2)
+				<< "scanlines " << std::setw(8) << scanlineTime << " ms (" << std::setw(6) << bandwidth(scanlineTime) << " GB/s)   "
+				<< "blocks " << std::setw(8) << blockTime << " ms (" << std::setw(6) << bandwidth(blockTime) << " GB/s)" << std::endl;
+		}
+
+		float GetRelativeError(float reference, float value)
+		{
+			const float magnitude{ std::max(std::abs(reference), std::abs(value)) };
+			return magnitude > 0.f ? std::abs(value - reference) / magnitude : 0.f;
+		}
+
+		float GetRelativeError(const Vector3& reference, const Vector3& value)
+		{
+			return std::max({ GetRelativeError(reference.x, value.x), GetRelativeError(reference.y, value.y), GetRelativeError(reference.z, value.z) });
+		}
+
+		float GetRelativeError(const Vector4& reference, const Vector4& value)
+		{
+			return std::max({ GetRelativeError(reference.x, value.x), GetRelativeError(reference.y, value.y), GetRelativeError(reference.z, value.z), GetRelativeError(reference.w, value.w) });
+		}
+
+		// Meshes only get transformed, so they don't need an effect
+		std::unique_ptr<Mesh> LoadMesh(const std::string& filename, BaseEffect::VertexFormat vertexFormat = BaseEffect::VertexFormat::Full)
+		{
+			std::vector<Vertex> vertices{};
+			std::vector<uint32_t> indices{};
+
+			if (!Utils::ParseOBJ(filename, vertices, indices)) {
+				std::cout << "    Could not load " << filename << std::endl;
+				return nullptr;
+			}
+
+			return std::make_unique<Mesh>(Mesh::PrimitiveTopology::TriangleList, std::move(vertices), std::move(indices), nullptr, vertexFormat);
+		}
+
+		// Same view as the renderer, with the mesh turned a bit so every matrix element matters
+		VertexStage::Transform GetTransform(float rotation = 1.f)
+		{
+			constexpr int width{ 640 };
+			constexpr int height{ 480 };
+
+			Camera camera{};
+			camera.Initialize(width, height, 45.f, { 0.f, 0.f, 0.f });
+
+			const Matrix world{ Matrix::CreateRotationY(rotation) * Matrix::CreateTranslation({ 0.f, 0.f, 50.f }) };
+			return {
+				world,
+				world * camera.invViewMatrix * camera.projectionMatrix,
+				camera.origin,
+				static_cast<float>(width),
+				static_cast<float>(height)
+			};
+		}
+
+		// Single sided triangles without textures, every vertex gets the same normal so each mesh shades as one flat color
+		std::unique_ptr<Mesh> CreateFlatMesh(const std::vector<Vector3>& positions, const Vector3& normal)
+		{
+			std::vector<Vertex> vertices{};
+			std::vector<uint32_t> indices{};
+
+			for (const Vector3& position : positions) {
+				indices.push_back(static_cast<uint32_t>(vertices.size()));
+				vertices.push_back({ position, colors::White, {}, normal, Vector3::UnitX });
+			}
+
+			std::unique_ptr<Mesh> pMesh{ std::make_unique<Mesh>(Mesh::PrimitiveTopology::TriangleList, std::move(vertices), std::move(indices), nullptr) };
+			pMesh->SetCullMode(Mesh::CullMode::None);
+			pMesh->SetWorldMatrix(Matrix::CreateTranslation({ 0.f, 0.f, 0.f }));
+			return pMesh;
+		}
+
+		uint32_t GetWindowPixel(SDL_Window* pWindow, int px, int py)
+		{
+			const SDL_Surface* pSurface{ SDL_GetWindowSurface(pWindow) };
+			return static_cast<const uint32_t*>(pSurface->pixels)[py * (pSurface->pitch / sizeof(uint32_t)) + px];
+		}
+
+		// Output of the vertex stage for one mesh
+		struct TransformedMesh {
+			const Mesh* pMesh;
+			std::vector<OutVertex> outVertices;
+			std::vector<Vector4> clipPositions;
+		};
+
+		// Transforms the chunks of all meshes like the software backend does, returns the fastest pass in milliseconds
+		double MeasureChunks(ThreadPool& threadPool, const VertexStage::Transform& transform, std::vector<TransformedMesh>& meshes)
+		{
+			std::vector<VertexStage::Chunk> chunks{};
+			for (size_t meshIndex{}; meshIndex < meshes.size(); ++meshIndex) {
+				VertexStage::AppendChunks(meshIndex, meshes[meshIndex].outVertices.size(), chunks);
+			}
+
+			return BestTime([&](int) {
+				threadPool.ParallelFor(chunks.size(), [&](size_t chunkIndex) {
+					const VertexStage::Chunk& chunk{ chunks[chunkIndex] };
+					TransformedMesh& mesh{ meshes[chunk.meshIndex] };
+
+					VertexStage::TransformSimd(*mesh.pMesh, transform, mesh.outVertices.data(), mesh.clipPositions.data(), chunk.begin, chunk.end);
+				});
+			});
+		}
+
+		// Barycentric weights from the screen positions as they are, the renderer snaps them to its subpixel grid first
+		bool GetWeightPlanes(const OutVertex& v0, const OutVertex& v1, const OutVertex& v2, int anchorX, int anchorY, AttributeSetup::Plane(&weights)[3])
+		{
+			const Vector4* positions[3]{ &v0.position, &v1.position, &v2.position };
+
+			const float area{ (v1.position.x - v0.position.x) * (v2.position.y - v0.position.y) - (v1.position.y - v0.position.y) * (v2.position.x - v0.position.x) };
+			if (std::abs(area) < FLT_EPSILON) {
+				return false;
+			}
+
+			// Center of the anchor pixel
+			const float centerX{ static_cast<float>(anchorX) + 0.5f };
+			const float centerY{ static_cast<float>(anchorY) + 0.5f };
+
+			// Edge i lies opposite of vertex i, its edge function equals the area at that vertex
+			for (int index{}; index < 3; ++index) {
+				const Vector4& start{ *positions[(index + 1) % 3] };
+				const Vector4& end{ *positions[(index + 2) % 3] };
+
+				const float deltaX{ end.x - start.x };
+				const float deltaY{ end.y - start.y };
+
+				weights[index] = {
+					(deltaX * (centerY - start.y) - deltaY * (centerX - start.x)) / area,
+					-deltaY / area,
+					deltaX / area
+				};
+			}
+
+			return true;
+		}
+
+		// Covered pixel of a triangle, relative to the anchor of its planes
+		struct AttributeSample {
+			size_t triangleIndex;
+			float x;
+			float y;
+			float weights[3];
+		};
+
+		// Triangle in front of the camera, its planes are anchored at the top left pixel of its bounding box
+		struct CoveredTriangle {
+			const OutVertex* vertices[3];
+			AttributeSetup::Plane weights[3];
+			int startX;
+			int startY;
+		};
+
+		// Triangles in front of the camera and their covered pixel centers on the screen, a triangle at a time and a row at a time
+		// There is no depth test, hidden pixels count as well
+		void GetCoverage(const Mesh& mesh, const std::vector<OutVertex>& outVertices, int width, int height,
+			std::vector<CoveredTriangle>& triangles, std::vector<AttributeSample>& samples)
+		{
+			const std::vector<uint32_t>& indices{ mesh.GetIndices() };
+			for (size_t index{}; index + 2 < indices.size(); index += 3) {
+				CoveredTriangle triangle{ { &outVertices[indices[index]], &outVertices[indices[index + 1]], &outVertices[indices[index + 2]] } };
+				const OutVertex& v0{ *triangle.vertices[0] };
+				const OutVertex& v1{ *triangle.vertices[1] };
+				const OutVertex& v2{ *triangle.vertices[2] };
+
+				if (v0.position.w <= 0.f || v1.position.w <= 0.f || v2.position.w <= 0.f) {
+					continue;
+				}
+
+				triangle.startX = std::max(static_cast<int>(std::floor(std::min({ v0.position.x, v1.position.x, v2.position.x }))), 0);
+				triangle.startY = std::max(static_cast<int>(std::floor(std::min({ v0.position.y, v1.position.y, v2.position.y }))), 0);
+				const int endX{ std::min(static_cast<int>(std::ceil(std::max({ v0.position.x, v1.position.x, v2.position.x }))), width) };
+				const int endY{ std::min(static_cast<int>(std::ceil(std::max({ v0.position.y, v1.position.y, v2.position.y }))), height) };
+
+				if (triangle.startX >= endX || triangle.startY >= endY || !GetWeightPlanes(v0, v1, v2, triangle.startX, triangle.startY, triangle.weights)) {
+					continue;
+				}
+
+				for (int py{ triangle.startY }; py < endY; ++py) {
+					for (int px{ triangle.startX }; px < endX; ++px) {
+						AttributeSample sample{ triangles.size(), static_cast<float>(px - triangle.startX), static_cast<float>(py - triangle.startY) };
+
+						bool isCovered{ true };
+						for (int vertex{}; vertex < 3; ++vertex) {
+							sample.weights[vertex] = triangle.weights[vertex].At(sample.x, sample.y);
+							isCovered = isCovered && sample.weights[vertex] >= 0.f;
+						}
+
+						if (isCovered) {
+							samples.push_back(sample);
+						}
+					}
+				}
+
+				triangles.push_back(triangle);
+			}
+		}
+
+		// Where a pixel samples a texture, with the uv steps to its neighbours
+		struct TextureSample {
+			Vector2 uv;
+			Vector2 ddx;
+			Vector2 ddy;
+		};
+
+		// A quarter of the texture's width fills the screen's width, every texel covers a few pixels
+		std::vector<TextureSample> GetMagnifiedSamples(int width, int height)
+		{
+			const Vector2 ddx{ 0.25f / width, 0.f };
+			const Vector2 ddy{ 0.f, 0.25f / width };
+
+			std::vector<TextureSample> samples{};
+			for (int py{}; py < height; ++py) {
+				for (int px{}; px < width; ++px) {
+					samples.push_back({ { (px + 0.5f) * ddx.x, (py + 0.5f) * ddy.y }, ddx, ddy });
+				}
+			}
+
+			return samples;
+		}
+
+		// The texture repeats four times over the width, rows get squeezed towards the top until a pixel spans 8 times as far down as across
+		std::vector<TextureSample> GetTiltedSamples(int width, int height)
+		{
+			const float repeats{ 4.f };
+			const Vector2 ddx{ repeats / width, 0.f };
+
+			std::vector<TextureSample> samples{};
+			for (int py{}; py < height; ++py) {
+				// The row step grows linearly from the bottom to the top, v is its running sum
+				const float distance{ static_cast<float>(height - py) - 0.5f };
+				const float stretch{ 1.f + 7.f * distance / height };
+				const float v{ repeats / width * (distance + 3.5f * distance * distance / height) };
+				const Vector2 ddy{ 0.f, -repeats / width * stretch };
+
+				for (int px{}; px < width; ++px) {
+					samples.push_back({ { (px + 0.5f) * ddx.x, v }, ddx, ddy });
+				}
+			}
+
+			return samples;
+		}
+
+		// Rotations of the vehicle for the benchmarks that sample its textures
+		constexpr float VEHICLE_ROTATIONS[]{ 0.f, 1.f, 2.f, 3.f, 4.f, 5.f };
+
+		// Uv and derivatives of every fragment of the vehicle at every rotation, in the order its triangles cover them
+		std::vector<TextureSample> GetVehicleSamples(const Mesh& mesh)
+		{
+			std::vector<TextureSample> samples{};
+
+			for (float rotation : VEHICLE_ROTATIONS) {
+				const VertexStage::Transform transform{ GetTransform(rotation) };
+
+				std::vector<OutVertex> outVertices(mesh.GetVertexCount());
+				std::vector<Vector4> clipPositions(mesh.GetVertexCount());
+				VertexStage::TransformSimd(mesh, transform, outVertices.data(), clipPositions.data(), 0, outVertices.size());
+
+				std::vector<CoveredTriangle> triangles{};
+				std::vector<AttributeSample> coveredSamples{};
+				GetCoverage(mesh, outVertices, static_cast<int>(transform.width), static_cast<int>(transform.height), triangles, coveredSamples);
+
+				std::vector<AttributeSetup::Planes> planes(triangles.size());
+				for (size_t index{}; index < triangles.size(); ++index) {
+					const CoveredTriangle& triangle{ triangles[index] };
+					AttributeSetup::Setup(*triangle.vertices[0], *triangle.vertices[1], *triangle.vertices[2], triangle.weights, AttributeSetup::uvVarying, planes[index]);
+				}
+
+				for (const AttributeSample& coveredSample : coveredSamples) {
+					const CoveredTriangle& triangle{ triangles[coveredSample.triangleIndex] };
+					const AttributeSetup::Planes& trianglePlanes{ planes[coveredSample.triangleIndex] };
+
+					// Quads start at even pixels of the screen, like in the renderer
+					const int px{ triangle.startX + static_cast<int>(coveredSample.x) };
+					const int py{ triangle.startY + static_cast<int>(coveredSample.y) };
+
+					TextureSample sample{ AttributeSetup::Interpolate(trianglePlanes, coveredSample.x, coveredSample.y, AttributeSetup::uvVarying).uv };
+					AttributeSetup::GetTexCoordDerivatives(trianglePlanes, static_cast<float>((px & ~1) - triangle.startX), static_cast<float>((py & ~1) - triangle.startY),
+						sample.ddx, sample.ddy);
+
+					samples.push_back(sample);
+				}
+			}
+
+			return samples;
+		}
+
+		// Set associative cache that replaces the least recently used line, counts the misses of the addresses it reads
+		class CacheModel final
+		{
+		public:
+			CacheModel(size_t size, size_t wayCount, size_t lineSize) :
+				m_WayCount{ wayCount },
+				m_SetCount{ size / (wayCount * lineSize) },
+				m_LineSize{ lineSize },
+				m_Lines(size / lineSize, SIZE_MAX)
+			{
+			}
+
+			void Read(size_t address)
+			{
+				const size_t line{ address / m_LineSize };
+				size_t* pSet{ m_Lines.data() + (line % m_SetCount) * m_WayCount };
+
+				// Every set is ordered from the most to the least recently used line
+				size_t way{};
+				while (way < m_WayCount && pSet[way] != line) {
+					++way;
+				}
+
+				if (way == m_WayCount) {
+					++m_MissCount;
+					--way;
+				}
+
+				for (; way > 0; --way) {
+					pSet[way] = pSet[way - 1];
+				}
+				pSet[0] = line;
+			}
+
+			uint64_t GetMissCount() const { return m_MissCount; }
+
+		private:
+			size_t m_WayCount;
+			size_t m_SetCount;
+			size_t m_LineSize;
+			std::vector<size_t> m_Lines;
+			uint64_t m_MissCount{};
+		};
+
+		float GetVectorError(const Vector3& reference, const Vector3& value)
+		{
+			const float magnitude{ std::max(reference.Magnitude(), value.Magnitude()) };
+			return magnitude > 0.f ? (value - reference).Magnitude() / magnitude : 0.f;
+		}
+	}
+
+	void Benchmark::RunDepthLayouts()
+	{
+		const Resolution resolutions[]{
+			{ "640x480", 640, 480 },
+			{ "1920x1080 (1080p)", 1920, 1080 },
+			{ "3840x2160 (4K)", 3840, 2160 }
+		};
+
+		std::cout << "[Benchmark - Depth buffer layouts]" << '\n';
+		std::cout << "    Depth test and write per pixel, fastest of " << PASS_COUNT << " passes" << '\n';
+
+		for (const Resolution& resolution : resolutions) {
+			std::cout << '\n' << "  " << resolution.name << std::endl;
+
+			// The layout the depth buffer used before it matched the color buffer
+			const int height{ resolution.height };
+			MeasureLayout(resolution, "column-major (previous)", static_cast<size_t>(resolution.width) * height,
+				[height](int px, int py) { return static_cast<size_t>(py) + static_cast<size_t>(height) * px; });
+
+			const std::pair<const char*, PixelLayout::Type> layouts[]{
+				{ "linear", PixelLayout::Type::linear },
+				{ "tiled", PixelLayout::Type::tiled },
+				{ "morton", PixelLayout::Type::morton }
+			};
+
+			for (const auto& [name, type] : layouts) {
+				const PixelLayout layout{ type, resolution.width, resolution.height };
+				MeasureLayout(resolution, name, layout.GetSize(), [&layout](int px, int py) { return layout.GetIndex(px, py); });
+			}
+		}
+
+		std::cout << std::endl;
+	}
+
+	void Benchmark::RunVertexStage()
+	{
+		std::cout << "[Benchmark - Vertex stage]" << '\n';
+
+		const std::pair<const char*, BaseEffect::VertexFormat> formats[]{
+			{ "full", BaseEffect::VertexFormat::Full },
+			{ "compact", BaseEffect::VertexFormat::Compact }
+		};
+
+		// The full format is the reference for how much the compact one loses
+		std::vector<OutVertex> fullVertices{};
+
+		for (const auto& [formatName, format] : formats) {
+			const std::unique_ptr<Mesh> pMesh{ LoadMesh("resources/vehicle.obj", format) };
+			if (!pMesh) {
+				return;
+			}
+
+			const Mesh& mesh{ *pMesh };
+			const size_t vertexCount{ mesh.GetVertexCount() };
+			const VertexStage::Transform transform{ GetTransform() };
+
+			std::vector<OutVertex> scalarVertices(vertexCount);
+			std::vector<Vector4> scalarClipPositions(vertexCount);
+			std::vector<OutVertex> simdVertices(vertexCount);
+			std::vector<Vector4> simdClipPositions(vertexCount);
+
+			const double scalarTime{ BestTime([&](int) {
+				VertexStage::TransformScalar(mesh, transform, scalarVertices.data(), scalarClipPositions.data(), 0, vertexCount);
+			}) };
+			const double simdTime{ BestTime([&](int) {
+				VertexStage::TransformSimd(mesh, transform, simdVertices.data(), simdClipPositions.data(), 0, vertexCount);
+			}) };
+
+			float maxError{};
+			for (size_t index{}; index < vertexCount; ++index) {
+				const OutVertex& reference{ scalarVertices[index] };
+				const OutVertex& vertex{ simdVertices[index] };
+
+				maxError = std::max({ maxError,
+					GetRelativeError(scalarClipPositions[index], simdClipPositions[index]),
+					GetRelativeError(reference.position, vertex.position),
+					GetRelativeError(reference.normal, vertex.normal),
+					GetRelativeError(reference.tangent, vertex.tangent),
+					GetRelativeError(reference.worldPosition, vertex.worldPosition)
+				});
+			}
+
+			const auto throughput = [vertexCount](double milliseconds) { return static_cast<double>(vertexCount) / (milliseconds * 1e3); };
+
+			std::cout << "    vehicle.obj, " << formatName << " format, " << vertexCount << " vertices, "
+				<< mesh.GetVertexMemory() / 1024 << " KiB (" << mesh.GetVertexMemory() / vertexCount << " bytes per vertex), fastest of " << PASS_COUNT << " passes" << '\n';
+			std::cout << std::fixed << std::setprecision(3)
+				<< "    scalar  " << std::setw(8) << scalarTime << " ms (" << std::setw(8) << throughput(scalarTime) << " Mvertices/s)" << '\n'
+				<< "    simd    " << std::setw(8) << simdTime << " ms (" << std::setw(8) << throughput(simdTime) << " Mvertices/s)" << '\n';
+			std::cout << std::scientific << std::setprecision(2)
+				<< "    max relative error " << maxError << " (tolerance " << VertexStage::MAX_RELATIVE_ERROR << ") "
+				<< (maxError <= VertexStage::MAX_RELATIVE_ERROR ? "ok" : "FAILED") << std::defaultfloat << '\n';
+
+			// Quantization error against the full format, as the angle between the normals and the distance between the texture coordinates
+			if (fullVertices.empty()) {
+				fullVertices = std::move(simdVertices);
+			} else {
+				float maxNormalAngle{};
+				float maxTangentAngle{};
+				float maxTexCoordError{};
+
+				for (size_t index{}; index < vertexCount; ++index) {
+					const OutVertex& reference{ fullVertices[index] };
+					const OutVertex& vertex{ simdVertices[index] };
+
+					maxNormalAngle = std::max(maxNormalAngle, std::acos(std::clamp(Vector3::Dot(reference.normal, vertex.normal), -1.f, 1.f)));
+					maxTangentAngle = std::max(maxTangentAngle, std::acos(std::clamp(Vector3::Dot(reference.tangent, vertex.tangent), -1.f, 1.f)));
+					maxTexCoordError = std::max({ maxTexCoordError, std::abs(reference.uv.x - vertex.uv.x), std::abs(reference.uv.y - vertex.uv.y) });
+				}
+
+				std::cout << std::scientific << std::setprecision(2)
+					<< "    quantization error: normal " << maxNormalAngle * TO_DEGREES << " degrees, tangent " << maxTangentAngle * TO_DEGREES
+					<< " degrees, uv " << maxTexCoordError << std::defaultfloat << '\n';
+			}
+		}
+
+		std::cout << std::endl;
+	}
+
+	void Benchmark::RunAttributeSetup()
+	{
+		std::cout << "[Benchmark - Attribute setup]" << '\n';
+
+		const std::unique_ptr<Mesh> pMesh{ LoadMesh("resources/vehicle.obj") };
+		if (!pMesh) {
+			return;
+		}
+
+		const Mesh& mesh{ *pMesh };
+		const VertexStage::Transform transform{ GetTransform() };
+		const int width{ static_cast<int>(transform.width) };
+		const int height{ static_cast<int>(transform.height) };
+
+		std::vector<OutVertex> outVertices(mesh.GetVertexCount());
+		std::vector<Vector4> clipPositions(mesh.GetVertexCount());
+		VertexStage::TransformSimd(mesh, transform, outVertices.data(), clipPositions.data(), 0, outVertices.size());
+
+		// Every attribute, like the combined shading mode with normal mapping
+		const uint8_t varyings{ AttributeSetup::uvVarying | AttributeSetup::normalVarying | AttributeSetup::tangentVarying | AttributeSetup::worldPositionVarying };
+
+		std::vector<CoveredTriangle> triangles{};
+		std::vector<AttributeSample> samples{};
+		GetCoverage(mesh, outVertices, width, height, triangles, samples);
+
+		std::vector<AttributeSetup::Planes> planes(triangles.size());
+		std::vector<AttributeSetup::Fragment> referenceFragments(samples.size());
+		std::vector<AttributeSetup::Fragment> fragments(samples.size());
+
+		const double setupTime{ BestTime([&](int) {
+			for (size_t index{}; index < triangles.size(); ++index) {
+				const CoveredTriangle& triangle{ triangles[index] };
+				AttributeSetup::Setup(*triangle.vertices[0], *triangle.vertices[1], *triangle.vertices[2], triangle.weights, varyings, planes[index]);
+			}
+		}) };
+
+		const double weightsTime{ BestTime([&](int) {
+			for (size_t index{}; index < samples.size(); ++index) {
+				const AttributeSample& sample{ samples[index] };
+				const CoveredTriangle& triangle{ triangles[sample.triangleIndex] };
+
+				referenceFragments[index] = AttributeSetup::InterpolateWeights(*triangle.vertices[0], *triangle.vertices[1], *triangle.vertices[2],
+					sample.weights[0], sample.weights[1], sample.weights[2], varyings);
+			}
+		}) };
+
+		const double planesTime{ BestTime([&](int) {
+			for (size_t index{}; index < samples.size(); ++index) {
+				const AttributeSample& sample{ samples[index] };
+				fragments[index] = AttributeSetup::Interpolate(planes[sample.triangleIndex], sample.x, sample.y, varyings);
+			}
+		}) };
+
+		float maxTexCoordError{};
+		float maxNormalError{};
+		float maxWorldPositionError{};
+
+		for (size_t index{}; index < samples.size(); ++index) {
+			const AttributeSetup::Fragment& reference{ referenceFragments[index] };
+			const AttributeSetup::Fragment& fragment{ fragments[index] };
+
+			maxTexCoordError = std::max({ maxTexCoordError, std::abs(reference.uv.x - fragment.uv.x), std::abs(reference.uv.y - fragment.uv.y) });
+			maxNormalError = std::max({ maxNormalError, GetVectorError(reference.normal, fragment.normal), GetVectorError(reference.tangent, fragment.tangent) });
+			maxWorldPositionError = std::max(maxWorldPositionError, GetVectorError(reference.worldPosition, fragment.worldPosition));
+		}
+
+		const auto throughput = [](size_t count, double milliseconds) { return static_cast<double>(count) / (milliseconds * 1e3); };
+
+		std::cout << "    vehicle.obj, " << triangles.size() << " triangles covering " << samples.size() << " pixels, every attribute, fastest of " << PASS_COUNT << " passes" << '\n';
+		std::cout << std::fixed << std::setprecision(3)
+			<< "    setup          " << std::setw(8) << setupTime << " ms (" << std::setw(8) << throughput(triangles.size(), setupTime) << " Mtriangles/s)" << '\n'
+			<< "    weighted sums  " << std::setw(8) << weightsTime << " ms (" << std::setw(8) << throughput(samples.size(), weightsTime) << " Mpixels/s)" << '\n'
+			<< "    planes         " << std::setw(8) << planesTime << " ms (" << std::setw(8) << throughput(samples.size(), planesTime) << " Mpixels/s)"
+			<< ", with setup " << std::setw(8) << throughput(samples.size(), planesTime + setupTime) << " Mpixels/s" << '\n';
+		std::cout << std::scientific << std::setprecision(2)
+			<< "    max difference: uv " << maxTexCoordError << ", normal and tangent " << maxNormalError
+			<< ", world position (relative) " << maxWorldPositionError << std::defaultfloat << '\n';
+
+		std::cout << std::endl;
+	}
+
+	void Benchmark::RunTextureSampling()
+	{
+		std::cout << "[Benchmark - Texture sampling]" << '\n';
+
+		// Without a device the texture stays in memory only
+		const std::shared_ptr<Texture> pTexture{ Texture::LoadFromFile("resources/vehicle_diffuse.png", nullptr) };
+		if (!pTexture || pTexture->GetLevelCount() == 0) {
+			return;
+		}
+
+		const Texture& texture{ *pTexture };
+		const int width{ 640 };
+		const int height{ 480 };
+
+		const std::pair<const char*, std::vector<TextureSample>> workloads[]{
+			{ "magnified", GetMagnifiedSamples(width, height) },
+			{ "tilted", GetTiltedSamples(width, height) }
+		};
+
+		const std::pair<const char*, Texture::Sampler> samplers[]{
+			{ "point", Texture::Sampler::Point },
+			{ "linear", Texture::Sampler::Linear },
+			{ "anisotropic", Texture::Sampler::Anisotropic }
+		};
+
+		std::vector<ColorRGB> colors(static_cast<size_t>(width) * height);
+
+		std::cout << "    vehicle_diffuse.png, " << texture.GetLevelCount() << " levels, " << width << "x" << height
+			<< " samples, fastest of " << PASS_COUNT << " passes" << '\n';
+
+		for (const auto& [workloadName, samples] : workloads) {
+			std::cout << "    " << std::left << std::setw(10) << workloadName << std::right << std::fixed << std::setprecision(3);
+
+			double pointTime{};
+			for (const auto& [samplerName, sampler] : samplers) {
+				const double time{ BestTime([&](int) {
+					for (size_t index{}; index < samples.size(); ++index) {
+						const TextureSample& sample{ samples[index] };
+						colors[index] = texture.Sample(sample.uv, sample.ddx, sample.ddy, sampler);
+					}
+				}) };
+
+				if (sampler == Texture::Sampler::Point) {
+					pointTime = time;
+				}
+
+				std::cout << "   " << samplerName << " " << std::setw(7) << time << " ms (x" << std::setprecision(2) << time / pointTime << ")" << std::setprecision(3);
+			}
+
+			std::cout << '\n';
+		}
+
+		std::cout << std::defaultfloat << std::endl;
+	}
+
+	void Benchmark::RunTextureLayouts()
+	{
+		std::cout << "[Benchmark - Texture layouts]" << '\n';
+
+		const std::unique_ptr<Mesh> pMesh{ LoadMesh("resources/vehicle.obj") };
+		if (!pMesh) {
+			return;
+		}
+
+		const Mesh& mesh{ *pMesh };
+
+		const std::pair<const char*, PixelLayout::Type> layouts[]{
+			{ "linear", PixelLayout::Type::linear },
+			{ "tiled", PixelLayout::Type::tiled },
+			{ "morton", PixelLayout::Type::morton }
+		};
+
+		std::vector<std::shared_ptr<Texture>> textures{};
+		for (const auto& [name, layout] : layouts) {
+			textures.push_back(Texture::LoadFromFile("resources/vehicle_diffuse.png", nullptr, layout));
+		}
+
+		for (const std::shared_ptr<Texture>& pTexture : textures) {
+			if (!pTexture || pTexture->GetLevelCount() == 0) {
+				return;
+			}
+		}
+
+		// Fragments of the vehicle at every rotation, in the order its triangles cover them
+		const std::vector<TextureSample> samples{ GetVehicleSamples(mesh) };
+
+		const std::pair<const char*, Texture::Sampler> samplers[]{
+			{ "point", Texture::Sampler::Point },
+			{ "linear", Texture::Sampler::Linear },
+			{ "anisotropic", Texture::Sampler::Anisotropic }
+		};
+
+		// About the L1 data cache of a desktop core
+		constexpr size_t cacheSize{ 32 * 1024 };
+		constexpr size_t cacheWayCount{ 8 };
+		constexpr size_t cacheLineSize{ 64 };
+
+		std::vector<ColorRGB> colors(samples.size());
+		std::vector<size_t> texelIndices{};
+
+		std::cout << "    vehicle.obj at " << std::size(VEHICLE_ROTATIONS) << " rotations, " << samples.size() << " fragments without a depth test, vehicle_diffuse.png, fastest of "
+			<< PASS_COUNT << " passes" << '\n';
+		std::cout << "    Misses replay the texels every sample reads through a " << cacheSize / 1024 << " KiB " << cacheWayCount << " way cache with "
+			<< cacheLineSize << " byte lines" << '\n';
+
+		for (const auto& [samplerName, sampler] : samplers) {
+			std::cout << '\n' << "  " << samplerName << std::endl;
+
+			double linearTime{};
+			for (size_t layoutIndex{}; layoutIndex < std::size(layouts); ++layoutIndex) {
+				const Texture& texture{ *textures[layoutIndex] };
+
+				const double time{ BestTime([&](int) {
+					for (size_t index{}; index < samples.size(); ++index) {
+						const TextureSample& sample{ samples[index] };
+						colors[index] = texture.Sample(sample.uv, sample.ddx, sample.ddy, sampler);
+					}
+				}) };
+
+				if (layoutIndex == 0) {
+					linearTime = time;
+				}
+
+				CacheModel cache{ cacheSize, cacheWayCount, cacheLineSize };
+				size_t texelCount{};
+
+				for (const TextureSample& sample : samples) {
+					texelIndices.clear();
+					texture.TraceSample(sample.uv, sample.ddx, sample.ddy, sampler, texelIndices);
+
+					for (size_t texelIndex : texelIndices) {
+						cache.Read(texelIndex * sizeof(uint32_t));
+					}
+					texelCount += texelIndices.size();
+				}
+
+				const double missesPerSample{ static_cast<double>(cache.GetMissCount()) / samples.size() };
+				const double missRate{ static_cast<double>(cache.GetMissCount()) / texelCount };
+
+				std::cout << "    " << std::left << std::setw(8) << layouts[layoutIndex].first << std::right << std::fixed << std::setprecision(3)
+					<< std::setw(8) << time << " ms (x" << std::setprecision(2) << time / linearTime << ", " << std::setw(6) << samples.size() / (time * 1e3) << " Msamples/s)"
+					<< "   misses " << std::setprecision(3) << std::setw(6) << missesPerSample << " per sample (" << std::setprecision(1) << std::setw(4) << missRate * 100.0
+					<< "% of " << std::setprecision(2) << static_cast<double>(texelCount) / samples.size() << " texels)" << '\n';
+			}
+		}
+
+		std::cout << std::defaultfloat << std::endl;
+	}
+
+	void Benchmark::RunMaterialSampling()
+	{
+		std::cout << "[Benchmark - Material sampling]" << '\n';
+
+		const std::unique_ptr<Mesh> pMesh{ LoadMesh("resources/vehicle.obj") };
+		if (!pMesh) {
+			return;
+		}
+
+		const std::shared_ptr<Texture> pDiffuse{ Texture::LoadFromFile("resources/vehicle_diffuse.png", nullptr) };
+		const std::shared_ptr<Texture> pNormal{ Texture::LoadFromFile("resources/vehicle_normal.png", nullptr) };
+		const std::shared_ptr<Texture> pGlossiness{ Texture::LoadFromFile("resources/vehicle_gloss.png", nullptr) };
+		const std::shared_ptr<Texture> pSpecular{ Texture::LoadFromFile("resources/vehicle_specular.png", nullptr) };
+
+		for (const Texture* pTexture : { pDiffuse.get(), pNormal.get(), pGlossiness.get(), pSpecular.get() }) {
+			if (!pTexture || pTexture->GetLevelCount() == 0) {
+				return;
+			}
+		}
+
+		if (!Material::CanBake(*pDiffuse, *pNormal, *pGlossiness, *pSpecular)) {
+			std::cout << "    The vehicle maps differ in size or layout" << std::endl;
+			return;
+		}
+
+		const Material material{ pDiffuse, *pNormal, *pGlossiness, *pSpecular };
+		const std::vector<TextureSample> samples{ GetVehicleSamples(*pMesh) };
+
+		const std::pair<const char*, Texture::Sampler> samplers[]{
+			{ "point", Texture::Sampler::Point },
+			{ "linear", Texture::Sampler::Linear },
+			{ "anisotropic", Texture::Sampler::Anisotropic }
+		};
+
+		std::vector<MaterialSample> materialSamples(samples.size());
+
+		std::cout << "    Every map of the combined shading mode, vehicle.obj at " << std::size(VEHICLE_ROTATIONS) << " rotations, " << samples.size()
+			<< " fragments without a depth test, fastest of " << PASS_COUNT << " passes" << '\n';
+
+		for (const auto& [samplerName, sampler] : samplers) {
+			const double mapsTime{ BestTime([&](int) {
+				for (size_t index{}; index < samples.size(); ++index) {
+					const TextureSample& sample{ samples[index] };
+					MaterialSample& materialSample{ materialSamples[index] };
+
+					materialSample.diffuse = pDiffuse->Sample(sample.uv, sample.ddx, sample.ddy, sampler);
+					materialSample.glossiness = pGlossiness->Sample(sample.uv, sample.ddx, sample.ddy, sampler).r;
+					materialSample.specular = pSpecular->Sample(sample.uv, sample.ddx, sample.ddy, sampler);
+					materialSample.normal = pNormal->SampleNormal(sample.uv, sample.ddx, sample.ddy, sampler);
+				}
+			}) };
+
+			const double bakedTime{ BestTime([&](int) {
+				for (size_t index{}; index < samples.size(); ++index) {
+					const TextureSample& sample{ samples[index] };
+					materialSamples[index] = material.Sample(sample.uv, sample.ddx, sample.ddy, sampler, Material::diffuseGlossStream | Material::normalSpecularStream);
+				}
+			}) };
+
+			std::cout << "    " << std::left << std::setw(12) << samplerName << std::right << std::fixed << std::setprecision(3)
+				<< "four maps " << std::setw(8) << mapsTime << " ms   two streams " << std::setw(8) << bakedTime << " ms (x" << std::setprecision(2) << mapsTime / bakedTime << ")" << '\n';
+		}
+
+		std::cout << std::defaultfloat << std::endl;
+	}
+
+	void Benchmark::RunVertexScaling()
+	{
+		std::cout << "[Benchmark - Vertex stage threads]" << '\n';
+
+		const std::unique_ptr<Mesh> pVehicle{ LoadMesh("resources/vehicle.obj") };
+		const std::unique_ptr<Mesh> pTuktuk{ LoadMesh("resources/tuktuk.obj") };
+		if (!pVehicle || !pTuktuk) {
+			return;
+		}
+
+		const auto createOutput = [](const Mesh& mesh) {
+			const size_t vertexCount{ mesh.GetVertexCount() };
+			return TransformedMesh{ &mesh, std::vector<OutVertex>(vertexCount), std::vector<Vector4>(vertexCount) };
+		};
+
+		// Each mesh on its own, then both at once like a frame of the renderer
+		std::pair<const char*, std::vector<TransformedMesh>> workloads[]{
+			{ "vehicle", {} },
+			{ "tuktuk", {} },
+			{ "both", {} }
+		};
+		workloads[0].second.push_back(createOutput(*pVehicle));
+		workloads[1].second.push_back(createOutput(*pTuktuk));
+		workloads[2].second.push_back(createOutput(*pVehicle));
+		workloads[2].second.push_back(createOutput(*pTuktuk));
+
+		const VertexStage::Transform transform{ GetTransform() };
+
+		// Powers of two up to the core count, and the core count itself
+		const int maxThreadCount{ std::max(static_cast<int>(std::thread::hardware_concurrency()), 1) };
+		std::vector<int> threadCounts{};
+		for (int threadCount{ 1 }; threadCount < maxThreadCount; threadCount *= 2) {
+			threadCounts.push_back(threadCount);
+		}
+		threadCounts.push_back(maxThreadCount);
+
+		std::cout << "    vehicle.obj " << pVehicle->GetVertexCount() << " vertices, tuktuk.obj " << pTuktuk->GetVertexCount()
+			<< " vertices, chunks of " << VertexStage::CHUNK_SIZE << ", fastest of " << PASS_COUNT << " passes" << '\n';
+
+		double singleThreadTimes[std::size(workloads)]{};
+
+		for (int threadCount : threadCounts) {
+			ThreadPool threadPool{ threadCount };
+
+			std::cout << "    " << std::setw(2) << threadCount << " thread(s)" << std::fixed << std::setprecision(3);
+
+			for (size_t workloadIndex{}; workloadIndex < std::size(workloads); ++workloadIndex) {
+				auto& [name, meshes] { workloads[workloadIndex] };
+
+				const double time{ MeasureChunks(threadPool, transform, meshes) };
+				if (threadCount == 1) {
+					singleThreadTimes[workloadIndex] = time;
+				}
+
+				std::cout << "   " << name << " " << std::setw(7) << time << " ms (x" << std::setprecision(2) << singleThreadTimes[workloadIndex] / time << ")" << std::setprecision(3);
+			}
+
+			std::cout << '\n';
+		}
+
+		std::cout << std::defaultfloat << std::endl;
+	}
+
+	void Benchmark::RunFrameChecks()
+	{
+		std::cout << "[Checks - Software frames]" << '\n';
+
+		const std::unique_ptr<Mesh> pMesh{ LoadMesh("resources/vehicle.obj") };
+		if (!pMesh) {
+			return;
+		}
+
+		constexpr int width{ 640 };
+		constexpr int height{ 480 };
+
+		// The backend presents to a window, it never gets shown
+		SDL_Init(SDL_INIT_VIDEO);
+		SDL_Window* pWindow{ SDL_CreateWindow("Frame checks", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, width, height, SDL_WINDOW_HIDDEN) };
+		if (!pWindow) {
+			std::cout << "    Could not create a window" << std::endl;
+			SDL_Quit();
+			return;
+		}
+
+		Camera camera{};
+		camera.Initialize(width, height, 45.f, { 0.f, 0.f, 0.f });
+
+		// A triangle from behind the near plane to far past a square, drawn before it
+		// The ray through the center of the screen hits the square at z = 5 and the triangle at z = 10.25
+		// The pixel halfway to the bottom only sees the triangle, at z = 2.98
+		Camera wideCamera{};
+		wideCamera.Initialize(width, height, 90.f, { 0.f, 0.f, 0.f });
+
+		const std::unique_ptr<Mesh> pStraddling{ CreateFlatMesh({ { 0.f, -2.f, .5f }, { -20.f, 2.f, 20.f }, { 20.f, 2.f, 20.f } }, Vector3{ -1.f, 1.f, -1.f }.Normalized()) };
+		const std::unique_ptr<Mesh> pOccluder{ CreateFlatMesh({ { -1.f, -1.f, 5.f }, { -1.f, 1.f, 5.f }, { 1.f, 1.f, 5.f }, { -1.f, -1.f, 5.f }, { 1.f, 1.f, 5.f }, { 1.f, -1.f, 5.f } }, { 0.f, 0.f, -1.f }) };
+		std::vector<Mesh*> occluderOnly{ pOccluder.get() };
+		std::vector<Mesh*> straddlingFirst{ pStraddling.get(), pOccluder.get() };
+
+		pMesh->SetWorldMatrix(Matrix::CreateRotationY(1.f) * Matrix::CreateTranslation({ 0.f, 0.f, 50.f }));
+		std::vector<Mesh*> meshes{ pMesh.get() };
+
+		// The immediate and the binned renderer, the second frame reuses the vertex stage output of the first
+		for (int threadCount : { 1, std::max(static_cast<int>(std::thread::hardware_concurrency()), 2) }) {
+			SoftwareRenderBackend backend{ pWindow, threadCount };
+
+			backend.Render(camera, meshes);
+			const SoftwareRenderBackend::Statistics first{ backend.GetStatistics() };
+
+			backend.Render(camera, meshes);
+			const SoftwareRenderBackend::Statistics second{ backend.GetStatistics() };
+
+			const bool reused{ first.meshesReused == 0 && second.meshesReused == 1 && second.trianglesSubmitted == first.trianglesSubmitted };
+			std::cout << "    " << std::setw(2) << threadCount << " thread(s), same camera and world matrix twice: "
+				<< first.trianglesSubmitted << " then " << second.trianglesSubmitted << " triangles " << (reused ? "ok" : "FAILED") << '\n';
+
+			// The two meshes only differ in their normals, which observed area shading turns into different grays
+			backend.CycleShadingMode();
+			backend.ToggleNormalMap();
+
+			backend.Render(wideCamera, occluderOnly);
+			const uint32_t occluderColor{ GetWindowPixel(pWindow, width / 2, height / 2) };
+			const uint32_t backgroundColor{ GetWindowPixel(pWindow, width / 2, height * 3 / 4) };
+
+			backend.Render(wideCamera, straddlingFirst);
+			const bool clipped{ backend.GetStatistics().trianglesClipped == 1 };
+			const bool occluded{ GetWindowPixel(pWindow, width / 2, height / 2) == occluderColor };
+			const bool drawn{ GetWindowPixel(pWindow, width / 2, height * 3 / 4) != backgroundColor };
+
+			std::cout << "    " << std::setw(2) << threadCount << " thread(s), triangle through the near plane behind a square: "
+				<< (clipped ? "clipped" : "not clipped") << ", " << (occluded ? "hidden" : "in front") << " at the center, "
+				<< (drawn ? "drawn" : "missing") << " below it " << (clipped && occluded && drawn ? "ok" : "FAILED") << '\n';
+		}
+
+		SDL_DestroyWindow(pWindow);
+		SDL_Quit();
+
+		std::cout << std::endl;
+	}
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+namespace dae
+{
+	// Micro benchmarks for the software renderer, started with the --benchmark argument
+	namespace Benchmark
+	{
+		// Depth test traffic of the rasterizer for every buffer layout at 640x480, 1080p and 4K
+		void RunDepthLayouts();
+
+		// Scalar against SIMD vertex transformation of the vehicle in both vertex formats
+		// Includes how far the results drift apart and how much the compact format loses to quantization
+		void RunVertexStage();
+
+		// Per pixel interpolation from the attribute planes of the vehicle's triangles against weighted sums of the vertex attributes
+		void RunAttributeSetup();
+
+		// Point, linear and anisotropic sampling of vehicle_diffuse.png, magnified and on a plane tilting away from the camera
+		void RunTextureSampling();
+
+		// Timing and modelled cache misses of every texture layout, sampling vehicle_diffuse.png where the vehicle covers the screen at several rotations
+		void RunTextureLayouts();
+
+		// The four maps of the vehicle sampled one by one against the two streams of its baked material
+		void RunMaterialSampling();
+
+		// Chunked vertex transformation of vehicle.obj and tuktuk.obj on 1 up to the number of cores
+		void RunVertexScaling();
+
+		// Frames of the software backend whose outcome is known up front, rendered into a hidden window and reported as ok or FAILED
+		void RunFrameChecks();
+	}
+}
@@ -20,10 +20,14 @@ void dae::Camera::CalculateViewMatrix() {
 	viewMatrix = { { right, 0.f }, { up, 0.f }, { forward, 0.f }, { origin, 1.f } };
 	invViewMatrix = viewMatrix;
 	invViewMatrix.Inverse();
+
+	++version;
 }
 
 void dae::Camera::CalculateProjectionMatrix() {
 	projectionMatrix = Matrix::CreatePerspectiveFovLH(fov, aspectRatio, zNear, zFar);
+
+	++version;
 }
 
 dae::Matrix dae::Camera::GetWorldViewProjectionMatrix() const {
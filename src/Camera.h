@@ -1,5 +1,6 @@
 #pragma once
 #include <cassert>
+#include <cstdint>
 #include <SDL_keyboard.h>
 #include <SDL_mouse.h>
 
@@ -40,6 +41,9 @@ namespace dae {
 		Matrix viewMatrix{};
 		Matrix projectionMatrix{};
 
+		// Incremented whenever the view or projection matrix gets recalculated, so renderers can tell when to redo view dependent work
+		uint32_t version{};
+
 		void Initialize(int screenWidth, int screenHeight, float _fovAngle = 90.f, Vector3 _origin = { 0.f,0.f,0.f });
 
 		void CalculateViewMatrix();
@@ -56,7 +56,8 @@ namespace dae {
 		Vector3 cameraOrigin{ camera.origin };
 
 		for (Mesh* mesh : meshes) {
-			if (!mesh->Visible()) {
+			// Meshes without an effect are only rendered by the software backend
+			if (!mesh->Visible() || !mesh->GetEffect()) {
 				continue;
 			}
 
@@ -91,6 +92,10 @@ namespace dae {
 		}
 	}
 
+	BaseEffect::TechniqueType DirectXRenderBackend::GetTechnique() const {
+		return m_EffectTechnique;
+	}
+
 	ID3D11Device* DirectXRenderBackend::GetDevice() {
 		return m_pDevice;
 	}
@@ -29,6 +29,7 @@ namespace dae
 		void Render(const Camera& camera, std::vector<Mesh*>& meshes) override;
 
 		void SwitchTechnique();
+		BaseEffect::TechniqueType GetTechnique() const;
 
 		ID3D11Device* GetDevice();
 	private:
@@ -0,0 +1,97 @@
+#include "Material.h"
+
+//Standard includes
+#include <emmintrin.h>
+
+namespace dae
+{
+	namespace
+	{
+		// Blends the four 8 channel texels of a quad in 8 bit fixed point, one texel fills a register once widened to 16 bits
+		void FilterWideQuad(const uint64_t* pTexels, const Texture::Footprint::Quad& quad, __m128& low, __m128& high)
+		{
+			const __m128i zero{ _mm_setzero_si128() };
+
+			// A channel of 255 at the full weight still fits 16 bits unsigned, and so does any sum of the four products
+			__m128i sums{ zero };
+			for (int corner{}; corner < 4; ++corner) {
+				const __m128i texel{ _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pTexels + quad.indices[corner])) };
+				sums = _mm_add_epi16(sums, _mm_mullo_epi16(_mm_unpacklo_epi8(texel, zero), _mm_set1_epi16(quad.weights[corner])));
+			}
+
+			const __m128 scale{ _mm_set1_ps(1.f / (255.f * (1 << 8))) };
+			low = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(sums, zero)), scale);
+			high = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(sums, zero)), scale);
+		}
+	}
+
+	bool Material::CanBake(const Texture& diffuse, const Texture& normal, const Texture& glossiness, const Texture& specular)
+	{
+		return diffuse.HasSameLevels(normal) && diffuse.HasSameLevels(glossiness) && diffuse.HasSameLevels(specular);
+	}
+
+	Material::Material(std::shared_ptr<Texture> pDiffuse, const Texture& normal, const Texture& glossiness, const Texture& specular) :
+		m_pDiffuse{ std::move(pDiffuse) }
+	{
+		const std::vector<uint32_t>& diffuseTexels{ m_pDiffuse->GetTexels() };
+		const std::vector<uint32_t>& normalTexels{ normal.GetTexels() };
+		const std::vector<uint32_t>& glossinessTexels{ glossiness.GetTexels() };
+		const std::vector<uint32_t>& specularTexels{ specular.GetTexels() };
+
+		m_DiffuseGloss.resize(diffuseTexels.size());
+		m_NormalSpecular.resize(diffuseTexels.size());
+
+		// Padding of swizzled levels is zero in every map, so it stays zero in the streams as well
+		for (size_t index{}; index < diffuseTexels.size(); ++index) {
+			m_DiffuseGloss[index] = (diffuseTexels[index] & 0x00FFFFFF) | ((glossinessTexels[index] & 0xFF) << 24);
+			m_NormalSpecular[index] = (normalTexels[index] & 0x00FFFFFF) | (static_cast<uint64_t>(specularTexels[index] & 0x00FFFFFF) << 24);
+		}
+	}
+
+	MaterialSample Material::Sample(const Vector2& uv, const Vector2& ddx, const Vector2& ddy, Texture::Sampler sampler, uint8_t streams) const
+	{
+		Texture::Footprint footprint;
+		m_pDiffuse->GetFootprint(uv, ddx, ddy, sampler, footprint);
+
+		__m128 diffuseGloss{ _mm_setzero_ps() };
+		__m128 normalSpecularLow{ _mm_setzero_ps() };
+		__m128 normalSpecularHigh{ _mm_setzero_ps() };
+
+		for (int quadIndex{}; quadIndex < footprint.quadCount; ++quadIndex) {
+			const Texture::Footprint::Quad& quad{ footprint.quads[quadIndex] };
+			const __m128 weight{ _mm_set1_ps(quad.weight) };
+
+			if (streams & diffuseGlossStream) {
+				diffuseGloss = _mm_add_ps(diffuseGloss, _mm_mul_ps(Texture::FilterQuad(m_DiffuseGloss.data(), quad), weight));
+			}
+
+			if (streams & normalSpecularStream) {
+				__m128 low;
+				__m128 high;
+				FilterWideQuad(m_NormalSpecular.data(), quad, low, high);
+
+				normalSpecularLow = _mm_add_ps(normalSpecularLow, _mm_mul_ps(low, weight));
+				normalSpecularHigh = _mm_add_ps(normalSpecularHigh, _mm_mul_ps(high, weight));
+			}
+		}
+
+		float channels[12];
+		_mm_storeu_ps(channels, diffuseGloss);
+		_mm_storeu_ps(channels + 4, normalSpecularLow);
+		_mm_storeu_ps(channels + 8, normalSpecularHigh);
+
+		MaterialSample sample{};
+
+		if (streams & diffuseGlossStream) {
+			sample.diffuse = ColorRGB{ channels[0], channels[1], channels[2] };
+			sample.glossiness = channels[3];
+		}
+
+		if (streams & normalSpecularStream) {
+			sample.normal = 2.f * Vector3{ channels[4], channels[5], channels[6] } - Vector3{ 1.f, 1.f, 1.f };
+			sample.specular = ColorRGB{ channels[7], channels[8], channels[9] };
+		}
+
+		return sample;
+	}
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+//Standard includes
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+//Project includes
+#include "ColorRGB.h"
+#include "Texture.h"
+#include "Vector2.h"
+#include "Vector3.h"
+
+namespace dae
+{
+	// What the maps of a mesh hold at the uv of a pixel
+	struct MaterialSample {
+		ColorRGB diffuse;
+		// Red channel of the glossiness map
+		float glossiness;
+		ColorRGB specular;
+		// Tangent space direction in [-1, 1], not normalized
+		Vector3 normal;
+	};
+
+	// The diffuse, glossiness, normal and specular map of a mesh, baked at load into two interleaved texel streams
+	// A pixel reads one texel per stream where it used to read one from every map, the streams keep the levels and layout of the maps
+	class Material final
+	{
+	public:
+		enum Stream : uint8_t {
+			// RGBA8, diffuse RGB with the glossiness in alpha
+			diffuseGlossStream = 1 << 0,
+			// 8 bytes, normal XYZ then specular RGB and two bytes of padding
+			normalSpecularStream = 1 << 1
+		};
+
+		// Maps of different sizes or layouts address their texels differently, those can't share a stream
+		static bool CanBake(const Texture& diffuse, const Texture& normal, const Texture& glossiness, const Texture& specular);
+
+		// The diffuse map stays referenced, its levels address the streams
+		Material(std::shared_ptr<Texture> pDiffuse, const Texture& normal, const Texture& glossiness, const Texture& specular);
+
+		// Only reads the streams asked for, the fields of the others stay zero
+		MaterialSample Sample(const Vector2& uv, const Vector2& ddx, const Vector2& ddy, Texture::Sampler sampler, uint8_t streams) const;
+
+	private:
+		std::shared_ptr<Texture> m_pDiffuse;
+
+		std::vector<uint32_t> m_DiffuseGloss{};
+		std::vector<uint64_t> m_NormalSpecular{};
+	};
+}
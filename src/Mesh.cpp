@@ -1,12 +1,97 @@
 #include "Mesh.h"
 
-Mesh::Mesh(PrimitiveTopology topology, std::vector<Vertex> vertices, std::vector<uint32_t> indices, std::shared_ptr<BaseEffect> pBaseEffect)
-	: m_Vertices(std::move(vertices)), m_Indices(std::move(indices)), m_pIndexBuffer{}, m_NumIndices{ static_cast<uint32_t>(m_Indices.size()) }, m_PrimitiveTopology(topology) {
+#include <cfloat>
+#include <numeric>
+#include <tuple>
+
+#include "Quantization.h"
+
+Mesh::Mesh(PrimitiveTopology topology, std::vector<Vertex> vertices, std::vector<uint32_t> indices, std::shared_ptr<BaseEffect> pBaseEffect, BaseEffect::VertexFormat vertexFormat)
+	: m_VertexFormat(vertexFormat), m_VertexCount(vertices.size()), m_Indices(std::move(indices)), m_pIndexBuffer{}, m_NumIndices{ static_cast<uint32_t>(m_Indices.size()) }, m_PrimitiveTopology(topology) {
 	
 	m_pEffect = pBaseEffect;
 
 	// Preallocate memory for output vertices
-	m_OutVertices.assign(m_Vertices.size(), {});
+	m_OutVertices.assign(vertices.size(), {});
+
+	// Split the vertices up so the software renderer can transform several at once
+	for (const Vertex& vertex : vertices) {
+		m_VertexStreams.positionX.push_back(vertex.position.x);
+		m_VertexStreams.positionY.push_back(vertex.position.y);
+		m_VertexStreams.positionZ.push_back(vertex.position.z);
+
+		// The compact format packs these instead
+		if (m_VertexFormat == BaseEffect::VertexFormat::Compact) {
+			continue;
+		}
+
+		m_VertexStreams.normalX.push_back(vertex.normal.x);
+		m_VertexStreams.normalY.push_back(vertex.normal.y);
+		m_VertexStreams.normalZ.push_back(vertex.normal.z);
+
+		m_VertexStreams.tangentX.push_back(vertex.tangent.x);
+		m_VertexStreams.tangentY.push_back(vertex.tangent.y);
+		m_VertexStreams.tangentZ.push_back(vertex.tangent.z);
+
+		m_VertexStreams.uvs.push_back(vertex.uv);
+		m_VertexStreams.colors.push_back(vertex.color);
+	}
+
+	// Bounds for culling, they don't change as long as the vertices don't
+	if (!vertices.empty()) {
+		m_Bounds.min = vertices[0].position;
+		m_Bounds.max = vertices[0].position;
+	}
+
+	for (const Vertex& vertex : vertices) {
+		m_Bounds.min = { std::min(m_Bounds.min.x, vertex.position.x), std::min(m_Bounds.min.y, vertex.position.y), std::min(m_Bounds.min.z, vertex.position.z) };
+		m_Bounds.max = { std::max(m_Bounds.max.x, vertex.position.x), std::max(m_Bounds.max.y, vertex.position.y), std::max(m_Bounds.max.z, vertex.position.z) };
+	}
+
+	m_Bounds.center = (m_Bounds.min + m_Bounds.max) / 2.f;
+	m_Bounds.radius = (m_Bounds.max - m_Bounds.center).Magnitude();
+
+	if (m_VertexFormat == BaseEffect::VertexFormat::Compact) {
+		CompactVertices(vertices);
+	}
+}
+
+void Mesh::CompactVertices(const std::vector<Vertex>& vertices) {
+	if (vertices.empty()) {
+		return;
+	}
+
+	// Texture coordinates get spread over the range the mesh uses
+	Vector2 texCoordMin{ vertices[0].uv };
+	Vector2 texCoordMax{ vertices[0].uv };
+
+	// Vertex colors only get a stream when they differ, the color of an OBJ is always white
+	const uint32_t firstColor{ dae::Quantization::EncodeColor(vertices[0].color) };
+	bool uniformColor{ true };
+
+	for (const Vertex& vertex : vertices) {
+		texCoordMin = { std::min(texCoordMin.x, vertex.uv.x), std::min(texCoordMin.y, vertex.uv.y) };
+		texCoordMax = { std::max(texCoordMax.x, vertex.uv.x), std::max(texCoordMax.y, vertex.uv.y) };
+		uniformColor = uniformColor && dae::Quantization::EncodeColor(vertex.color) == firstColor;
+	}
+
+	m_VertexStreams.texCoordOffset = texCoordMin;
+	m_VertexStreams.texCoordScale = (texCoordMax - texCoordMin) / dae::Quantization::UNORM16_MAX;
+	m_VertexStreams.packedColor = firstColor;
+
+	for (const Vertex& vertex : vertices) {
+		m_VertexStreams.texCoords.push_back(dae::Quantization::EncodeTexCoord(vertex.uv, m_VertexStreams.texCoordOffset, m_VertexStreams.texCoordScale));
+		m_VertexStreams.normals.push_back(dae::Quantization::EncodeOctahedral(vertex.normal));
+		m_VertexStreams.tangents.push_back(dae::Quantization::EncodeOctahedral(vertex.tangent));
+
+		if (!uniformColor) {
+			m_VertexStreams.packedColors.push_back(dae::Quantization::EncodeColor(vertex.color));
+		}
+	}
+}
+
+Vector3 Mesh::GetPosition(uint32_t index) const {
+	return { m_VertexStreams.positionX[index], m_VertexStreams.positionY[index], m_VertexStreams.positionZ[index] };
 }
 
 Mesh::~Mesh() {
@@ -14,6 +99,10 @@ Mesh::~Mesh() {
 		m_pVertexBuffer->Release();
 	}
 
+	if (m_pColorBuffer) {
+		m_pColorBuffer->Release();
+	}
+
 	if (m_pIndexBuffer) {
 		m_pIndexBuffer->Release();
 	}
@@ -25,21 +114,65 @@ void Mesh::BindDevice(ID3D11Device* pDevice) {
 		return;
 	}
 
+	// Without an effect there is nothing to draw it with
+	if (!m_pEffect) {
+		return;
+	}
+
+	if (m_pEffect->GetVertexFormat() != m_VertexFormat) {
+		std::cout << "Mesh and effect use a different vertex format, the mesh can't be drawn" << std::endl;
+		return;
+	}
+
+	// Vertices are only put together for the upload, the vertex streams keep them afterwards
+	const VertexStreams& streams{ m_VertexStreams };
+	std::vector<Vertex> vertices{};
+	std::vector<CompactVertex> compactVertices{};
+
+	if (m_VertexFormat == BaseEffect::VertexFormat::Compact) {
+		compactVertices.reserve(m_VertexCount);
+
+		for (uint32_t index{}; index < m_VertexCount; ++index) {
+			compactVertices.push_back({ GetPosition(index), streams.texCoords[index], streams.normals[index], streams.tangents[index] });
+		}
+	} else {
+		vertices.reserve(m_VertexCount);
+
+		for (uint32_t index{}; index < m_VertexCount; ++index) {
+			vertices.push_back({ GetPosition(index), streams.colors[index], streams.uvs[index],
+				{ streams.normalX[index], streams.normalY[index], streams.normalZ[index] },
+				{ streams.tangentX[index], streams.tangentY[index], streams.tangentZ[index] } });
+		}
+	}
+
 	D3D11_BUFFER_DESC bd{};
 	bd.Usage = D3D11_USAGE_IMMUTABLE;
-	bd.ByteWidth = sizeof(Vertex) * static_cast<uint32_t>(m_Vertices.size());
+	bd.ByteWidth = static_cast<uint32_t>(m_VertexFormat == BaseEffect::VertexFormat::Compact ? sizeof(CompactVertex) : sizeof(Vertex)) * static_cast<uint32_t>(m_VertexCount);
 	bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
 	bd.CPUAccessFlags = 0;
 	bd.MiscFlags = 0;
 
 	D3D11_SUBRESOURCE_DATA initData{};
-	initData.pSysMem = m_Vertices.data();
+	initData.pSysMem = m_VertexFormat == BaseEffect::VertexFormat::Compact ? static_cast<const void*>(compactVertices.data()) : vertices.data();
 	HRESULT result{ pDevice->CreateBuffer(&bd, &initData, &m_pVertexBuffer) };
 
 	if (FAILED(result)) {
 		return;
 	}
 
+	// A uniform color is a single element, the input assembler reads it for every vertex with a stride of zero
+	if (m_VertexFormat == BaseEffect::VertexFormat::Compact) {
+		const bool uniformColor{ streams.packedColors.empty() };
+
+		bd.ByteWidth = static_cast<uint32_t>(sizeof(uint32_t) * (uniformColor ? 1 : streams.packedColors.size()));
+		initData.pSysMem = uniformColor ? &streams.packedColor : streams.packedColors.data();
+		result = pDevice->CreateBuffer(&bd, &initData, &m_pColorBuffer);
+
+		if (FAILED(result)) {
+			return;
+		}
+	}
+
 	m_NumIndices = static_cast<uint32_t>(m_Indices.size());
 	bd.Usage = D3D11_USAGE_IMMUTABLE;
 	bd.ByteWidth = sizeof(uint32_t) * m_NumIndices;
@@ -57,6 +190,10 @@ void Mesh::BindDevice(ID3D11Device* pDevice) {
 }
 
 void Mesh::Draw(ID3D11DeviceContext* pDeviceContext, BaseEffect::TechniqueType technique) const {
+	if (!m_IsBound) {
+		return;
+	}
+
 	// Primitive topoligies that are supported
 	switch (m_PrimitiveTopology) {
 		case PrimitiveTopology::TriangleStrip:
@@ -69,10 +206,24 @@ void Mesh::Draw(ID3D11DeviceContext* pDeviceContext, BaseEffect::TechniqueType t
 
 	pDeviceContext->IASetInputLayout(m_pEffect->GetInputLayout());
 
-	constexpr UINT stride{ sizeof(Vertex) };
-	constexpr UINT offset = 0;
+	// What the compact vertices left out is the same for the whole mesh
+	if (m_VertexFormat == BaseEffect::VertexFormat::Compact) {
+		m_pEffect->SetCompactVertexConstants(m_VertexStreams.texCoordOffset, m_VertexStreams.texCoordScale * dae::Quantization::UNORM16_MAX);
+	}
+
+	if (m_VertexFormat == BaseEffect::VertexFormat::Compact) {
+		ID3D11Buffer* const buffers[2]{ m_pVertexBuffer, m_pColorBuffer };
+		const UINT strides[2]{ static_cast<UINT>(sizeof(CompactVertex)), m_VertexStreams.packedColors.empty() ? 0u : static_cast<UINT>(sizeof(uint32_t)) };
+		constexpr UINT offsets[2]{};
+
+		pDeviceContext->IASetVertexBuffers(0, 2, buffers, strides, offsets);
+	} else {
+		constexpr UINT stride = sizeof(Vertex);
+		constexpr UINT offset = 0;
+
+		pDeviceContext->IASetVertexBuffers(0, 1, &m_pVertexBuffer, &stride, &offset);
+	}
 
-	pDeviceContext->IASetVertexBuffers(0, 1, &m_pVertexBuffer, &stride, &offset);
 	pDeviceContext->IASetIndexBuffer(m_pIndexBuffer, DXGI_FORMAT_R32_UINT, 0);
 
 	D3DX11_TECHNIQUE_DESC techDesc{};
@@ -84,8 +235,232 @@ void Mesh::Draw(ID3D11DeviceContext* pDeviceContext, BaseEffect::TechniqueType t
 	}
 }
 
-const std::vector<Vertex>& Mesh::GetVertices() const {
-	return m_Vertices;
+const VertexStreams& Mesh::GetVertexStreams() const {
+	return m_VertexStreams;
+}
+
+size_t Mesh::GetVertexCount() const {
+	return m_VertexCount;
+}
+
+BaseEffect::VertexFormat Mesh::GetVertexFormat() const {
+	return m_VertexFormat;
+}
+
+size_t Mesh::GetVertexMemory() const {
+	const auto streamSize = [](const auto& stream) { return stream.size() * sizeof(stream[0]); };
+	const VertexStreams& streams{ m_VertexStreams };
+
+	return streamSize(streams.positionX) + streamSize(streams.positionY) + streamSize(streams.positionZ)
+		+ streamSize(streams.normalX) + streamSize(streams.normalY) + streamSize(streams.normalZ)
+		+ streamSize(streams.tangentX) + streamSize(streams.tangentY) + streamSize(streams.tangentZ)
+		+ streamSize(streams.uvs) + streamSize(streams.colors)
+		+ streamSize(streams.texCoords) + streamSize(streams.normals) + streamSize(streams.tangents) + streamSize(streams.packedColors);
+}
+
+const MeshBounds& Mesh::GetBounds() const {
+	return m_Bounds;
+}
+
+void Mesh::BuildMeshlets() {
+	m_Meshlets.clear();
+	m_MeshletVertices.clear();
+
+	if (m_PrimitiveTopology != PrimitiveTopology::TriangleList) {
+		return;
+	}
+
+	const uint32_t triangleCount{ static_cast<uint32_t>(m_Indices.size() / 3) };
+
+	// Vertices on a uv or normal seam are split, so neighbours are found through the positions the vertices share
+	std::vector<uint32_t> positionIds(m_VertexCount);
+	{
+		std::vector<uint32_t> order(m_VertexCount);
+		std::iota(order.begin(), order.end(), 0);
+
+		const auto isLess = [this](uint32_t left, uint32_t right) {
+			const Vector3 a{ GetPosition(left) };
+			const Vector3 b{ GetPosition(right) };
+			return std::tie(a.x, a.y, a.z) < std::tie(b.x, b.y, b.z);
+		};
+		std::sort(order.begin(), order.end(), isLess);
+
+		uint32_t positionId{};
+		for (size_t index{}; index < order.size(); ++index) {
+			if (index > 0 && isLess(order[index - 1], order[index])) {
+				++positionId;
+			}
+
+			positionIds[order[index]] = positionId;
+		}
+	}
+
+	// Normals point to the side from which a triangle counts as a back face, degenerate triangles have none
+	std::vector<Vector3> normals(triangleCount);
+	std::vector<std::vector<uint32_t>> positionTriangles(m_VertexCount);
+
+	for (uint32_t triangle{}; triangle < triangleCount; ++triangle) {
+		const Vector3 p0{ GetPosition(m_Indices[triangle * 3]) };
+		const Vector3 p1{ GetPosition(m_Indices[triangle * 3 + 1]) };
+		const Vector3 p2{ GetPosition(m_Indices[triangle * 3 + 2]) };
+
+		const Vector3 normal{ Vector3::Cross(p1 - p0, p2 - p0) };
+		if (normal.SqrMagnitude() > 0.f) {
+			normals[triangle] = normal.Normalized();
+		}
+
+		for (uint32_t corner{}; corner < 3; ++corner) {
+			positionTriangles[positionIds[m_Indices[triangle * 3 + corner]]].push_back(triangle);
+		}
+	}
+
+	std::vector<bool> isUsed(triangleCount, false);
+	std::vector<uint32_t> orderedIndices{};
+	orderedIndices.reserve(m_Indices.size());
+
+	// Position in the current meshlet of every vertex it uses so far
+	std::vector<uint32_t> localIndices(m_VertexCount, UINT32_MAX);
+
+	const auto countNewVertices = [&](uint32_t triangle) {
+		uint32_t newVertexCount{};
+		for (uint32_t corner{}; corner < 3; ++corner) {
+			if (localIndices[m_Indices[triangle * 3 + corner]] == UINT32_MAX) {
+				++newVertexCount;
+			}
+		}
+
+		return newVertexCount;
+	};
+
+	uint32_t seed{};
+
+	while (true) {
+		// Every meshlet starts at the first triangle that isn't in one yet
+		while (seed < triangleCount && isUsed[seed]) {
+			++seed;
+		}
+
+		if (seed == triangleCount) {
+			break;
+		}
+
+		Meshlet meshlet{};
+		meshlet.vertexOffset = static_cast<uint32_t>(m_MeshletVertices.size());
+		meshlet.triangleOffset = static_cast<uint32_t>(orderedIndices.size() / 3);
+
+		Vector3 normalSum{};
+		uint32_t triangle{ seed };
+
+		// Grows over neighbouring triangles, preferring those that add few vertices and face the same way as the meshlet
+		while (triangle != UINT32_MAX) {
+			isUsed[triangle] = true;
+			normalSum += normals[triangle];
+
+			for (uint32_t corner{}; corner < 3; ++corner) {
+				const uint32_t vertexIndex{ m_Indices[triangle * 3 + corner] };
+				orderedIndices.push_back(vertexIndex);
+
+				if (localIndices[vertexIndex] == UINT32_MAX) {
+					localIndices[vertexIndex] = meshlet.vertexCount++;
+					m_MeshletVertices.push_back(vertexIndex);
+				}
+			}
+
+			++meshlet.triangleCount;
+			triangle = UINT32_MAX;
+
+			if (meshlet.triangleCount == MAX_MESHLET_TRIANGLES) {
+				break;
+			}
+
+			const Vector3 axis{ normalSum.SqrMagnitude() > 0.f ? normalSum.Normalized() : Vector3{} };
+			float bestScore{ -FLT_MAX };
+
+			for (uint32_t index{ meshlet.vertexOffset }; index < meshlet.vertexOffset + meshlet.vertexCount; ++index) {
+				for (uint32_t candidate : positionTriangles[positionIds[m_MeshletVertices[index]]]) {
+					if (isUsed[candidate]) {
+						continue;
+					}
+
+					const uint32_t newVertexCount{ countNewVertices(candidate) };
+					if (meshlet.vertexCount + newVertexCount > MAX_MESHLET_VERTICES) {
+						continue;
+					}
+
+					// Degenerate triangles never get drawn, so they fit any cone
+					const bool isDegenerate{ normals[candidate].SqrMagnitude() == 0.f };
+					const float alignment{ isDegenerate ? 1.f : Vector3::Dot(normals[candidate], axis) };
+
+					// Too far off would widen the cone until it can't reject anything anymore
+					if (alignment < MIN_MESHLET_ALIGNMENT) {
+						continue;
+					}
+
+					const float score{ alignment - static_cast<float>(newVertexCount) * MESHLET_VERTEX_COST };
+					if (score > bestScore) {
+						bestScore = score;
+						triangle = candidate;
+					}
+				}
+			}
+		}
+
+		const uint32_t* pVertices{ m_MeshletVertices.data() + meshlet.vertexOffset };
+
+		// Bounding sphere around the center of the bounding box
+		Vector3 min{ GetPosition(pVertices[0]) };
+		Vector3 max{ min };
+
+		for (uint32_t index{}; index < meshlet.vertexCount; ++index) {
+			const Vector3 position{ GetPosition(pVertices[index]) };
+			min = { std::min(min.x, position.x), std::min(min.y, position.y), std::min(min.z, position.z) };
+			max = { std::max(max.x, position.x), std::max(max.y, position.y), std::max(max.z, position.z) };
+
+			localIndices[pVertices[index]] = UINT32_MAX;
+		}
+
+		meshlet.center = (min + max) / 2.f;
+		for (uint32_t index{}; index < meshlet.vertexCount; ++index) {
+			meshlet.radius = std::max(meshlet.radius, (GetPosition(pVertices[index]) - meshlet.center).Magnitude());
+		}
+
+		// The cone around the average normal has to contain the normal of every triangle
+		meshlet.coneCutoff = 1.f;
+
+		if (normalSum.SqrMagnitude() > 0.f) {
+			meshlet.coneAxis = normalSum.Normalized();
+
+			float minDot{ 1.f };
+			for (uint32_t index{ meshlet.triangleOffset }; index < meshlet.triangleOffset + meshlet.triangleCount; ++index) {
+				const Vector3 p0{ GetPosition(orderedIndices[index * 3]) };
+				const Vector3 p1{ GetPosition(orderedIndices[index * 3 + 1]) };
+				const Vector3 p2{ GetPosition(orderedIndices[index * 3 + 2]) };
+
+				const Vector3 normal{ Vector3::Cross(p1 - p0, p2 - p0) };
+				if (normal.SqrMagnitude() > 0.f) {
+					minDot = std::min(minDot, Vector3::Dot(normal.Normalized(), meshlet.coneAxis));
+				}
+			}
+
+			// Normals more than 90 degrees from the axis leave no direction from which all triangles are back faces
+			if (minDot > 0.f) {
+				meshlet.coneCutoff = std::sqrt(1.f - minDot * minDot);
+			}
+		}
+
+		m_Meshlets.push_back(meshlet);
+	}
+
+	// The triangles of a meshlet are consecutive in the index buffer
+	m_Indices = std::move(orderedIndices);
+}
+
+const std::vector<Meshlet>& Mesh::GetMeshlets() const {
+	return m_Meshlets;
+}
+
+const std::vector<uint32_t>& Mesh::GetMeshletVertices() const {
+	return m_MeshletVertices;
 }
 
 const std::vector<uint32_t>& Mesh::GetIndices() const {
@@ -93,14 +468,32 @@ const std::vector<uint32_t>& Mesh::GetIndices() const {
 }
 
 void Mesh::SetWorldMatrix(dae::Matrix matrix) {
+	// Compared exactly, Vector4 equality allows for an epsilon
+	for (int row{}; row < 4; ++row) {
+		const Vector4 newRow{ matrix[row] };
+		const Vector4 oldRow{ m_WorldMatrix[row] };
+
+		if (newRow.x != oldRow.x || newRow.y != oldRow.y || newRow.z != oldRow.z || newRow.w != oldRow.w) {
+			++m_WorldMatrixVersion;
+			break;
+		}
+	}
+
 	m_WorldMatrix = matrix;
-	m_pEffect->SetWorldMatrixVariable(m_WorldMatrix);
+
+	if (m_pEffect) {
+		m_pEffect->SetWorldMatrixVariable(m_WorldMatrix);
+	}
 }
 
 const dae::Matrix& Mesh::GetWorldMatrix() const {
 	return m_WorldMatrix;
 }
 
+uint32_t Mesh::GetWorldMatrixVersion() const {
+	return m_WorldMatrixVersion;
+}
+
 Mesh::PrimitiveTopology Mesh::GetTopology() const {
 	return m_PrimitiveTopology;;
 }
@@ -109,19 +502,19 @@ std::shared_ptr<BaseEffect> Mesh::GetEffect() const {
 	return m_pEffect;
 }
 
-std::shared_ptr<Texture> Mesh::GetDiffuse() const {
+const std::shared_ptr<Texture>& Mesh::GetDiffuse() const {
 	return m_pDiffuseTexture;
 }
 
-std::shared_ptr<Texture> Mesh::GetNormal() const {
+const std::shared_ptr<Texture>& Mesh::GetNormal() const {
 	return m_pNormalTexture;
 }
 
-std::shared_ptr<Texture> Mesh::GetSpecular() const {
+const std::shared_ptr<Texture>& Mesh::GetSpecular() const {
 	return m_pSpecularTexture;
 }
 
-std::shared_ptr<Texture> Mesh::GetGlossiness() const {
+const std::shared_ptr<Texture>& Mesh::GetGlossiness() const {
 	return m_pGlossinessTexture;
 }
 
@@ -145,6 +538,10 @@ void Mesh::ToggleCullMode() {
 void Mesh::SetCullMode(CullMode mode) {
 	m_CullMode = mode;
 
+	if (!m_pEffect) {
+		return;
+	}
+
 	switch (m_CullMode) {
 		case CullMode::BackFace:
 			m_pEffect->SetCullMode(D3D11_CULL_BACK);
@@ -164,22 +561,57 @@ Mesh::CullMode Mesh::GetCullMode() const {
 
 void Mesh::SetDiffuse(std::shared_ptr<Texture> pTexture) {
 	m_pDiffuseTexture = pTexture;
-	m_pEffect->SetDiffuseMap(pTexture);
+	m_pMaterial = nullptr;
+
+	if (m_pEffect) {
+		m_pEffect->SetDiffuseMap(pTexture);
+	}
 }
 
 void Mesh::SetNormal(std::shared_ptr<Texture> pTexture) {
 	m_pNormalTexture = pTexture;
-	m_pEffect->SetNormalMap(pTexture);
+	m_pMaterial = nullptr;
+
+	if (m_pEffect) {
+		m_pEffect->SetNormalMap(pTexture);
+	}
 }
 
 void Mesh::SetSpecular(std::shared_ptr<Texture> pTexture) {
 	m_pSpecularTexture = pTexture;
-	m_pEffect->SetSpecularMap(pTexture);
+	m_pMaterial = nullptr;
+
+	if (m_pEffect) {
+		m_pEffect->SetSpecularMap(pTexture);
+	}
 }
 
 void Mesh::SetGlossiness(std::shared_ptr<Texture> pTexture) {
 	m_pGlossinessTexture = pTexture;
-	m_pEffect->SetGlossinessMap(pTexture);
+	m_pMaterial = nullptr;
+
+	if (m_pEffect) {
+		m_pEffect->SetGlossinessMap(pTexture);
+	}
+}
+
+void Mesh::BakeMaterial() {
+	m_pMaterial = nullptr;
+
+	if (!m_pDiffuseTexture || !m_pNormalTexture || !m_pGlossinessTexture || !m_pSpecularTexture) {
+		return;
+	}
+
+	if (!Material::CanBake(*m_pDiffuseTexture, *m_pNormalTexture, *m_pGlossinessTexture, *m_pSpecularTexture)) {
+		std::cout << "Material maps differ in size or layout, they get sampled one by one" << std::endl;
+		return;
+	}
+
+	m_pMaterial = std::make_shared<Material>(m_pDiffuseTexture, *m_pNormalTexture, *m_pGlossinessTexture, *m_pSpecularTexture);
+}
+
+const std::shared_ptr<Material>& Mesh::GetMaterial() const {
+	return m_pMaterial;
 }
 
 bool Mesh::CanBeSoftwareRendered() const {
@@ -13,6 +13,7 @@
 #include "Vector2.h"
 #include "Vector4.h"
 #include "Texture.h"
+#include "Material.h"
 #include "Matrix.h"
 #include <memory>
 
@@ -21,6 +22,7 @@ using dae::Vector3;
 using dae::ColorRGB;
 using dae::Vector2;
 using dae::Texture;
+using dae::Material;
 
 struct Vertex {
 	Vector3 position;
@@ -30,17 +32,102 @@ struct Vertex {
 	Vector3 tangent;
 };
 
+// Vertex of the compact format, 24 bytes instead of the 56 of a full vertex
+// Texture coordinates are 16 bit unorm inside of the range of the mesh, normals and tangents 16 bit snorm octahedral directions
+// The color is not part of it, it goes in a buffer of its own that holds a single color when every vertex has the same one
+struct CompactVertex {
+	Vector3 position;
+	uint32_t texCoord;
+	uint32_t normal;
+	uint32_t tangent;
+};
+
+// Every attribute of the vertices of a mesh, one array per component (structure of arrays)
+// The software vertex stage transforms them from here, the GPU gets them interleaved again once at upload
+struct VertexStreams {
+	std::vector<float> positionX{};
+	std::vector<float> positionY{};
+	std::vector<float> positionZ{};
+
+	// Full format only
+	std::vector<float> normalX{};
+	std::vector<float> normalY{};
+	std::vector<float> normalZ{};
+
+	std::vector<float> tangentX{};
+	std::vector<float> tangentY{};
+	std::vector<float> tangentZ{};
+
+	// Full format only as well, the uv gets copied as a whole and the color only goes to the GPU
+	std::vector<Vector2> uvs{};
+	std::vector<ColorRGB> colors{};
+
+	// Compact format only, packed like the members of CompactVertex
+	std::vector<uint32_t> texCoords{};
+	std::vector<uint32_t> normals{};
+	std::vector<uint32_t> tangents{};
+	// 8 bit unorm RGBA, empty when the mesh has a uniform color
+	std::vector<uint32_t> packedColors{};
+
+	// Decoding of the compact texture coordinates
+	Vector2 texCoordOffset{};
+	Vector2 texCoordScale{};
+	// The color of every vertex when they all have the same one
+	uint32_t packedColor{};
+};
+
+// Bounds of the vertex positions in object space
+struct MeshBounds {
+	Vector3 min{};
+	Vector3 max{};
+
+	// Sphere around the center of the box that encloses all of it
+	Vector3 center{};
+	float radius{};
+};
+
+// A cluster of neighbouring triangles, the software backend can reject all of them at once
+struct Meshlet {
+	// Range in the meshlet vertices of the mesh, the vertices used by the triangles of the meshlet
+	uint32_t vertexOffset;
+	uint32_t vertexCount;
+
+	// Range of triangles in the index buffer, triangle t uses indices 3t, 3t + 1 and 3t + 2
+	uint32_t triangleOffset;
+	uint32_t triangleCount;
+
+	// Bounding sphere in object space
+	Vector3 center;
+	float radius;
+
+	// Normal cone in object space, the sine of the largest angle between the axis and a triangle normal
+	// A cutoff of 1 or more means the triangles face too many directions for the cone to reject anything
+	Vector3 coneAxis;
+	float coneCutoff;
+};
+
+// Vertex stage output of the software rasterizer
 struct OutVertex {
+	// Screen space x and y, the ndc depth and 1 / w, so perspective correct interpolation only multiplies
 	Vector4 position{};
-	ColorRGB color{};
 	Vector2 uv{};
 	Vector3 normal{};
 	Vector3 tangent{};
-	Vector3 viewDirection{};
+	// The view direction of every pixel follows from the world position and the camera origin
+	Vector3 worldPosition{};
 };
 
 class Mesh {
 public:
+	// Limits of a meshlet, the same as the usual limits for mesh shaders
+	static constexpr uint32_t MAX_MESHLET_VERTICES{ 64 };
+	static constexpr uint32_t MAX_MESHLET_TRIANGLES{ 124 };
+
+	// Smallest cosine between a triangle normal and the average normal of the meshlet it joins
+	static constexpr float MIN_MESHLET_ALIGNMENT{ 0.85f };
+	// How much a new vertex counts against the alignment of a triangle when growing a meshlet
+	static constexpr float MESHLET_VERTEX_COST{ 0.5f };
+
 	enum class PrimitiveTopology {
 		TriangleList,
 		TriangleStrip
@@ -53,8 +140,11 @@ public:
 		None
 	};
 
-	// Takes ownership of vertices and indices
-	Mesh(PrimitiveTopology topology, std::vector<Vertex> vertices, std::vector<uint32_t> indices, std::shared_ptr<BaseEffect> pBaseEffect);
+	// Takes ownership of the indices, the vertices only get split up into the vertex streams
+	// The compact format keeps them quantized, the effect has to use the same format
+	// A mesh without an effect never binds or draws on the GPU, only the software backend renders it
+	Mesh(PrimitiveTopology topology, std::vector<Vertex> vertices, std::vector<uint32_t> indices, std::shared_ptr<BaseEffect> pBaseEffect,
+		BaseEffect::VertexFormat vertexFormat = BaseEffect::VertexFormat::Full);
 	~Mesh();
 
 	// Meshes should not be copied
@@ -66,21 +156,36 @@ public:
 	void BindDevice(ID3D11Device* pDevice);
 	void Draw(ID3D11DeviceContext* pDeviceContext, BaseEffect::TechniqueType technique) const;
 
-	const std::vector<Vertex>& GetVertices() const;
+	const VertexStreams& GetVertexStreams() const;
+	size_t GetVertexCount() const;
+	BaseEffect::VertexFormat GetVertexFormat() const;
+	// Bytes of vertex data kept in memory, which is the vertex streams
+	size_t GetVertexMemory() const;
+	const MeshBounds& GetBounds() const;
+	// Object space position of a vertex, from the position streams
+	Vector3 GetPosition(uint32_t index) const;
+
+	// Splits a triangle list into meshlets of neighbouring triangles that face roughly the same way
+	// Reorders the index buffer so the triangles of every meshlet are consecutive, call it before binding the mesh
+	void BuildMeshlets();
+	const std::vector<Meshlet>& GetMeshlets() const;
+	const std::vector<uint32_t>& GetMeshletVertices() const;
 	const std::vector<uint32_t>& GetIndices() const;
 
+	// Setting the same matrix again keeps the version, so the software backend can reuse its transformed vertices
 	void SetWorldMatrix(dae::Matrix matrix);
 
 	const dae::Matrix& GetWorldMatrix() const;
+	uint32_t GetWorldMatrixVersion() const;
 
 	PrimitiveTopology GetTopology() const;
 
 	std::shared_ptr<BaseEffect> GetEffect() const;
 
-	std::shared_ptr<Texture> GetDiffuse() const;
-	std::shared_ptr<Texture> GetNormal() const;
-	std::shared_ptr<Texture> GetSpecular() const;
-	std::shared_ptr<Texture> GetGlossiness() const;
+	const std::shared_ptr<Texture>& GetDiffuse() const;
+	const std::shared_ptr<Texture>& GetNormal() const;
+	const std::shared_ptr<Texture>& GetSpecular() const;
+	const std::shared_ptr<Texture>& GetGlossiness() const;
 
 	void ToggleCullMode();
 	void SetCullMode(CullMode mode);
@@ -91,6 +196,11 @@ public:
 	void SetSpecular(std::shared_ptr<Texture> pTexture);
 	void SetGlossiness(std::shared_ptr<Texture> pTexture);
 
+	// Interleaves the four maps into the streams of a material for the software backend, call it once they are set
+	// Setting a map afterwards drops the material, the maps then get sampled one by one again
+	void BakeMaterial();
+	const std::shared_ptr<Material>& GetMaterial() const;
+
 	bool CanBeSoftwareRendered() const;
 	void DisableSoftwareRendering();
 
@@ -100,12 +210,20 @@ public:
 	bool Visible() const;
 	void SetVisible(bool val);
 private:
-	std::vector<Vertex> m_Vertices;
+	void CompactVertices(const std::vector<Vertex>& vertices);
+
+	VertexStreams m_VertexStreams;
+	BaseEffect::VertexFormat m_VertexFormat;
+	size_t m_VertexCount;
+	MeshBounds m_Bounds;
+	std::vector<Meshlet> m_Meshlets;
+	std::vector<uint32_t> m_MeshletVertices;
 	std::vector<OutVertex> m_OutVertices;
 	std::vector<uint32_t> m_Indices;
 	PrimitiveTopology m_PrimitiveTopology;
 
 	dae::Matrix m_WorldMatrix;
+	uint32_t m_WorldMatrixVersion{};
 
 	uint32_t m_NumIndices;
 
@@ -117,8 +235,11 @@ private:
 	std::shared_ptr<Texture> m_pNormalTexture{ nullptr };
 	std::shared_ptr<Texture> m_pSpecularTexture{ nullptr };
 	std::shared_ptr<Texture> m_pGlossinessTexture{ nullptr };
+	std::shared_ptr<Material> m_pMaterial{ nullptr };
 
 	ID3D11Buffer* m_pVertexBuffer{ nullptr };
+	// Colors of the compact format, the second vertex buffer
+	ID3D11Buffer* m_pColorBuffer{ nullptr };
 	ID3D11Buffer* m_pIndexBuffer{ nullptr };
 
 	CullMode m_CullMode{};
@@ -1,36 +1,70 @@
 #include "MeshEffect.h"
 
-MeshEffect::MeshEffect(ID3D11Device* pDevice, const std::wstring& assetFile) : BaseEffect(pDevice, assetFile) {
+MeshEffect::MeshEffect(ID3D11Device* pDevice, const std::wstring& assetFile, VertexFormat vertexFormat) : BaseEffect(pDevice, assetFile, vertexFormat) {
 	static constexpr uint32_t numElements{ 5 };
 	D3D11_INPUT_ELEMENT_DESC vertexDesc[numElements]{};
-	vertexDesc[0].SemanticName = "POSITION";
-	vertexDesc[0].Format = DXGI_FORMAT_R32G32B32_FLOAT;
-	vertexDesc[0].AlignedByteOffset = 0;
-	vertexDesc[0].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
-
-	vertexDesc[1].SemanticName = "COLOR";
-	vertexDesc[1].Format = DXGI_FORMAT_R32G32B32_FLOAT;
-	vertexDesc[1].AlignedByteOffset = 12;
-	vertexDesc[1].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
-
-	vertexDesc[2].SemanticName = "TEXCOORD";
-	vertexDesc[2].Format = DXGI_FORMAT_R32G32_FLOAT;
-	vertexDesc[2].AlignedByteOffset = 24;
-	vertexDesc[2].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
-
-	vertexDesc[3].SemanticName = "NORMAL";
-	vertexDesc[3].Format = DXGI_FORMAT_R32G32B32_FLOAT;
-	vertexDesc[3].AlignedByteOffset = 32;
-	vertexDesc[3].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
-
-	vertexDesc[4].SemanticName = "TANGENT";
-	vertexDesc[4].Format = DXGI_FORMAT_R32G32B32_FLOAT;
-	vertexDesc[4].AlignedByteOffset = 44;
-	vertexDesc[4].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+	uint32_t elementCount{ numElements };
+
+	if (vertexFormat == VertexFormat::Compact) {
+		// Matches CompactVertex, the input assembler turns the 16 and 8 bit values into floats
+		elementCount = 5;
+
+		vertexDesc[0].SemanticName = "POSITION";
+		vertexDesc[0].Format = DXGI_FORMAT_R32G32B32_FLOAT;
+		vertexDesc[0].AlignedByteOffset = 0;
+		vertexDesc[0].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+
+		vertexDesc[1].SemanticName = "TEXCOORD";
+		vertexDesc[1].Format = DXGI_FORMAT_R16G16_UNORM;
+		vertexDesc[1].AlignedByteOffset = 12;
+		vertexDesc[1].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+
+		vertexDesc[2].SemanticName = "NORMAL";
+		vertexDesc[2].Format = DXGI_FORMAT_R16G16_SNORM;
+		vertexDesc[2].AlignedByteOffset = 16;
+		vertexDesc[2].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+
+		vertexDesc[3].SemanticName = "TANGENT";
+		vertexDesc[3].Format = DXGI_FORMAT_R16G16_SNORM;
+		vertexDesc[3].AlignedByteOffset = 20;
+		vertexDesc[3].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+
+		// The color comes from a buffer of its own, see Mesh::BindDevice
+		vertexDesc[4].SemanticName = "COLOR";
+		vertexDesc[4].Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		vertexDesc[4].InputSlot = 1;
+		vertexDesc[4].AlignedByteOffset = 0;
+		vertexDesc[4].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+	} else {
+		vertexDesc[0].SemanticName = "POSITION";
+		vertexDesc[0].Format = DXGI_FORMAT_R32G32B32_FLOAT;
+		vertexDesc[0].AlignedByteOffset = 0;
+		vertexDesc[0].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+
+		vertexDesc[1].SemanticName = "COLOR";
+		vertexDesc[1].Format = DXGI_FORMAT_R32G32B32_FLOAT;
+		vertexDesc[1].AlignedByteOffset = 12;
+		vertexDesc[1].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+
+		vertexDesc[2].SemanticName = "TEXCOORD";
+		vertexDesc[2].Format = DXGI_FORMAT_R32G32_FLOAT;
+		vertexDesc[2].AlignedByteOffset = 24;
+		vertexDesc[2].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+
+		vertexDesc[3].SemanticName = "NORMAL";
+		vertexDesc[3].Format = DXGI_FORMAT_R32G32B32_FLOAT;
+		vertexDesc[3].AlignedByteOffset = 32;
+		vertexDesc[3].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+
+		vertexDesc[4].SemanticName = "TANGENT";
+		vertexDesc[4].Format = DXGI_FORMAT_R32G32B32_FLOAT;
+		vertexDesc[4].AlignedByteOffset = 44;
+		vertexDesc[4].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+	}
 
 	D3DX11_PASS_DESC passDesc{};
 	m_pPointTechnique->GetPassByIndex(0)->GetDesc(&passDesc);
-	HRESULT result{ pDevice->CreateInputLayout(vertexDesc, numElements, passDesc.pIAInputSignature, passDesc.IAInputSignatureSize, &m_pInputLayout) };
+	HRESULT result{ pDevice->CreateInputLayout(vertexDesc, elementCount, passDesc.pIAInputSignature, passDesc.IAInputSignatureSize, &m_pInputLayout) };
 
 	if (FAILED(result)) {
 		std::wcout << L"Failed creating effect input layout for point technique!\n";
@@ -38,7 +72,7 @@ MeshEffect::MeshEffect(ID3D11Device* pDevice, const std::wstring& assetFile) : B
 	}
 
 	m_pLinearTechnique->GetPassByIndex(0)->GetDesc(&passDesc);
-	result = pDevice->CreateInputLayout(vertexDesc, numElements, passDesc.pIAInputSignature, passDesc.IAInputSignatureSize, &m_pInputLayout);
+	result = pDevice->CreateInputLayout(vertexDesc, elementCount, passDesc.pIAInputSignature, passDesc.IAInputSignatureSize, &m_pInputLayout);
 
 	if (FAILED(result)) {
 		std::wcout << L"Failed creating effect input layout for linear technique!\n";
@@ -46,7 +80,7 @@ MeshEffect::MeshEffect(ID3D11Device* pDevice, const std::wstring& assetFile) : B
 	}
 
 	m_pAnisotropicTechnique->GetPassByIndex(0)->GetDesc(&passDesc);
-	result = pDevice->CreateInputLayout(vertexDesc, numElements, passDesc.pIAInputSignature, passDesc.IAInputSignatureSize, &m_pInputLayout);
+	result = pDevice->CreateInputLayout(vertexDesc, elementCount, passDesc.pIAInputSignature, passDesc.IAInputSignatureSize, &m_pInputLayout);
 
 	if (FAILED(result)) {
 		std::wcout << L"Failed creating effect input layout for anisotropic technique!\n";
@@ -12,5 +12,5 @@
 
 class MeshEffect final : public BaseEffect {
 public:
-	MeshEffect(ID3D11Device* pDevice, const std::wstring& assetFile);
+	MeshEffect(ID3D11Device* pDevice, const std::wstring& assetFile, VertexFormat vertexFormat = VertexFormat::Full);
 };
\ No newline at end of file
@@ -0,0 +1,91 @@
+#pragma once
+
+//Standard includes
+#include <cstddef>
+#include <cstdint>
+
+namespace dae
+{
+	// Maps 2D pixel coordinates onto the index of a 1D buffer
+	class PixelLayout final
+	{
+	public:
+		enum class Type {
+			// Scanlines, one row after the other
+			linear,
+			// Row-major TILE_SIZE x TILE_SIZE tiles, row-major pixels inside of a tile
+			tiled,
+			// Row-major TILE_SIZE x TILE_SIZE tiles, Z-order (Morton) pixels inside of a tile
+			morton
+		};
+
+		// Swizzled layouts round the buffer up to whole tiles
+		static constexpr int TILE_SIZE{ 8 };
+		static constexpr int TILE_BITS{ 3 };
+
+		PixelLayout() = default;
+
+		PixelLayout(Type type, int width, int height) :
+			m_Type{ type },
+			m_Width{ width },
+			m_Height{ height },
+			m_TilesX{ (width + TILE_SIZE - 1) / TILE_SIZE },
+			m_TilesY{ (height + TILE_SIZE - 1) / TILE_SIZE }
+		{
+		}
+
+		size_t GetIndex(int x, int y) const
+		{
+			switch (m_Type) {
+				case Type::tiled:
+					return GetTileStart(x, y) + ((y & (TILE_SIZE - 1)) << TILE_BITS) + (x & (TILE_SIZE - 1));
+
+				case Type::morton:
+					return GetTileStart(x, y) + Interleave(x & (TILE_SIZE - 1)) + (Interleave(y & (TILE_SIZE - 1)) << 1);
+
+				default:
+					return static_cast<size_t>(x) + static_cast<size_t>(y) * m_Width;
+			}
+		}
+
+		// Amount of elements the buffer needs, including padding
+		size_t GetSize() const
+		{
+			if (m_Type == Type::linear) {
+				return static_cast<size_t>(m_Width) * m_Height;
+			}
+
+			return static_cast<size_t>(m_TilesX) * m_TilesY * TILE_SIZE * TILE_SIZE;
+		}
+
+		// Whether 4 horizontal pixels starting at a multiple of 4 are next to each other in memory
+		bool HasContiguousQuads() const
+		{
+			return m_Type != Type::morton;
+		}
+
+		Type GetType() const { return m_Type; }
+		int GetWidth() const { return m_Width; }
+		int GetHeight() const { return m_Height; }
+
+	private:
+		size_t GetTileStart(int x, int y) const
+		{
+			return (static_cast<size_t>(x >> TILE_BITS) + static_cast<size_t>(y >> TILE_BITS) * m_TilesX) * TILE_SIZE * TILE_SIZE;
+		}
+
+		// Spreads the 3 bits of a tile coordinate out over the even bits
+		static size_t Interleave(int value)
+		{
+			return static_cast<size_t>((value & 1) | ((value & 2) << 1) | ((value & 4) << 2));
+		}
+
+		Type m_Type{ Type::linear };
+
+		int m_Width{};
+		int m_Height{};
+
+		int m_TilesX{};
+		int m_TilesY{};
+	};
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "ColorRGB.h"
+#include "Vector2.h"
+#include "Vector3.h"
+
+namespace dae
+{
+	// Packing of vertex attributes into 16 bit integers, two of them share a 32 bit word (x in the low half)
+	namespace Quantization
+	{
+		constexpr float SNORM16_MAX{ 32767.f };
+		constexpr float UNORM16_MAX{ 65535.f };
+
+		inline uint32_t PackPair(int32_t low, int32_t high)
+		{
+			return (static_cast<uint32_t>(low) & 0xFFFF) | (static_cast<uint32_t>(high) << 16);
+		}
+
+		// Maps a direction onto the octahedron |x| + |y| + |z| = 1, the lower half gets folded over the upper one
+		inline uint32_t EncodeOctahedral(const Vector3& direction)
+		{
+			const float sum{ std::abs(direction.x) + std::abs(direction.y) + std::abs(direction.z) };
+
+			// Degenerate directions (zero or NaN) become +z
+			if (!(sum > 0.f)) {
+				return 0;
+			}
+
+			float x{ direction.x / sum };
+			float y{ direction.y / sum };
+
+			if (direction.z < 0.f) {
+				const float foldedX{ (1.f - std::abs(y)) * (x >= 0.f ? 1.f : -1.f) };
+				const float foldedY{ (1.f - std::abs(x)) * (y >= 0.f ? 1.f : -1.f) };
+				x = foldedX;
+				y = foldedY;
+			}
+
+			const auto toSnorm = [](float value) { return static_cast<int32_t>(std::round(std::clamp(value, -1.f, 1.f) * SNORM16_MAX)); };
+			return PackPair(toSnorm(x), toSnorm(y));
+		}
+
+		// Not normalized, the vertex stage normalizes after the world transform anyway
+		// The SIMD decode in the vertex stage does the same operations in the same order
+		inline Vector3 DecodeOctahedral(uint32_t packed)
+		{
+			constexpr float scale{ 1.f / SNORM16_MAX };
+
+			float x{ static_cast<float>(static_cast<int16_t>(packed & 0xFFFF)) * scale };
+			float y{ static_cast<float>(static_cast<int16_t>(packed >> 16)) * scale };
+			const float z{ 1.f - std::abs(x) - std::abs(y) };
+
+			// Unfold the lower half
+			const float fold{ std::max(-z, 0.f) };
+			x -= std::copysign(fold, x);
+			y -= std::copysign(fold, y);
+
+			return { x, y, z };
+		}
+
+		// Texture coordinates as 16 bit unorm inside of the range of the mesh
+		// A coordinate decodes to offset + value * scale, the scale being the size of the range divided by the largest value
+		inline uint32_t EncodeTexCoord(const Vector2& uv, const Vector2& offset, const Vector2& scale)
+		{
+			const auto toUnorm = [](float value, float offset, float scale) {
+				return scale > 0.f ? static_cast<int32_t>(std::round(std::clamp((value - offset) / scale, 0.f, UNORM16_MAX))) : 0;
+			};
+
+			return PackPair(toUnorm(uv.x, offset.x, scale.x), toUnorm(uv.y, offset.y, scale.y));
+		}
+
+		inline Vector2 DecodeTexCoord(uint32_t packed, const Vector2& offset, const Vector2& scale)
+		{
+			return { offset.x + static_cast<float>(packed & 0xFFFF) * scale.x, offset.y + static_cast<float>(packed >> 16) * scale.y };
+		}
+
+		// 8 bit unorm RGBA, red in the lowest byte and an opaque alpha
+		inline uint32_t EncodeColor(const ColorRGB& color)
+		{
+			const auto toUnorm = [](float value) { return static_cast<uint32_t>(std::round(std::clamp(value, 0.f, 1.f) * 255.f)); };
+			return toUnorm(color.r) | (toUnorm(color.g) << 8) | (toUnorm(color.b) << 16) | 0xFF000000;
+		}
+	}
+}
@@ -20,7 +20,81 @@ void dae::Renderer::Update(const Timer* pTimer) {
 }
 
 void dae::Renderer::Render() {
-	m_pRenderBackend->Render(m_Camera, m_WorldMeshes);
+	UpdateFrustumPlanes();
+
+	// Only meshes that can end up on screen get transformed or drawn
+	m_VisibleMeshes.clear();
+	m_CulledMeshCount = 0;
+
+	for (Mesh* worldMesh : m_WorldMeshes) {
+		if (IsInFrustum(worldMesh)) {
+			m_VisibleMeshes.push_back(worldMesh);
+		} else {
+			++m_CulledMeshCount;
+		}
+	}
+
+	m_pRenderBackend->Render(m_Camera, m_VisibleMeshes);
+}
+
+void dae::Renderer::UpdateFrustumPlanes() {
+	// Planes of clip space, pulled out of the columns of the view projection matrix
+	const Matrix viewProjection{ m_Camera.invViewMatrix * m_Camera.projectionMatrix };
+
+	Vector4 columns[4]{};
+	for (int column{}; column < 4; ++column) {
+		columns[column] = { viewProjection[0][column], viewProjection[1][column], viewProjection[2][column], viewProjection[3][column] };
+	}
+
+	m_FrustumPlanes[0] = columns[3] + columns[0]; // Left, -w <= x
+	m_FrustumPlanes[1] = columns[3] - columns[0]; // Right, x <= w
+	m_FrustumPlanes[2] = columns[3] + columns[1]; // Bottom, -w <= y
+	m_FrustumPlanes[3] = columns[3] - columns[1]; // Top, y <= w
+	m_FrustumPlanes[4] = columns[2];              // Near, 0 <= z
+	m_FrustumPlanes[5] = columns[3] - columns[2]; // Far, z <= w
+
+	// Normalized, so the distances can be compared against the radius
+	for (Vector4& plane : m_FrustumPlanes) {
+		plane = plane * (1.f / Vector3{ plane.x, plane.y, plane.z }.Magnitude());
+	}
+}
+
+bool dae::Renderer::IsInFrustum(const Mesh* pMesh) const {
+	const MeshBounds& bounds{ pMesh->GetBounds() };
+	const Matrix& worldMatrix{ pMesh->GetWorldMatrix() };
+
+	// The box in world space, its axes scaled by the half extents
+	const Vector3 halfExtents{ (bounds.max - bounds.min) / 2.f };
+	const Vector3 center{ worldMatrix.TransformPoint(bounds.center) };
+	const Vector3 axisX{ worldMatrix.GetAxisX() * halfExtents.x };
+	const Vector3 axisY{ worldMatrix.GetAxisY() * halfExtents.y };
+	const Vector3 axisZ{ worldMatrix.GetAxisZ() * halfExtents.z };
+
+	// The sphere grows with the largest scale of the world matrix
+	const float scale{ std::max({ worldMatrix.GetAxisX().Magnitude(), worldMatrix.GetAxisY().Magnitude(), worldMatrix.GetAxisZ().Magnitude() }) };
+	const float radius{ bounds.radius * scale };
+
+	for (const Vector4& plane : m_FrustumPlanes) {
+		const Vector3 normal{ plane.x, plane.y, plane.z };
+		const float distance{ Vector3::Dot(normal, center) + plane.w };
+
+		// The sphere is cheap and decides most meshes
+		if (distance < -radius) {
+			return false;
+		}
+
+		if (distance >= radius) {
+			continue;
+		}
+
+		// The box is tighter for meshes that intersect the plane, only the corner furthest along the normal matters
+		const float projectedRadius{ std::abs(Vector3::Dot(normal, axisX)) + std::abs(Vector3::Dot(normal, axisY)) + std::abs(Vector3::Dot(normal, axisZ)) };
+		if (distance < -projectedRadius) {
+			return false;
+		}
+	}
+
+	return true;
 }
 
 void dae::Renderer::SetRenderBackend(AbstractRenderBackend* pRenderBackend) {
@@ -31,6 +105,10 @@ std::vector<Mesh*>& dae::Renderer::GetMeshes() {
 	return m_WorldMeshes;
 }
 
+int dae::Renderer::GetCulledMeshCount() const {
+	return m_CulledMeshCount;
+}
+
 void dae::Renderer::ToggleRotation() {
 	m_RotationEnabled = !m_RotationEnabled;
 
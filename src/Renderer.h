@@ -30,7 +30,15 @@ namespace dae {
 		void SetRenderBackend(AbstractRenderBackend* pRenderBackend);
 
 		std::vector<Mesh*>& GetMeshes();
+
+		// Meshes outside of the view frustum in the last rendered frame
+		int GetCulledMeshCount() const;
 	protected:
+		static constexpr int FRUSTUM_PLANE_COUNT{ 6 };
+
+		void UpdateFrustumPlanes();
+		bool IsInFrustum(const Mesh* pMesh) const;
+
 		AbstractRenderBackend* m_pRenderBackend;
 
 		Camera m_Camera{};
@@ -40,5 +48,12 @@ namespace dae {
 		float m_Rotation{ 0.f };
 
 		std::vector<Mesh*> m_WorldMeshes;
+
+		// Meshes that survived frustum culling, the ones that get handed to the backend
+		std::vector<Mesh*> m_VisibleMeshes;
+		int m_CulledMeshCount{};
+
+		// World space planes as (normal, distance), the normals point into the frustum
+		Vector4 m_FrustumPlanes[FRUSTUM_PLANE_COUNT]{};
 	};
 }
\ No newline at end of file
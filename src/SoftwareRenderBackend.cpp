@@ -2,12 +2,17 @@
 #include "SDL.h"
 #include "SDL_surface.h"
 
+#include <emmintrin.h>
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
 //Project includes
 #include "SoftwareRenderBackend.h"
 
 using namespace dae;
 
-SoftwareRenderBackend::SoftwareRenderBackend(SDL_Window* pWindow) :
+SoftwareRenderBackend::SoftwareRenderBackend(SDL_Window* pWindow, int threadCount, PixelLayout::Type layout) :
 	m_pWindow(pWindow)
 {
 	//Initialize
@@ -16,9 +21,45 @@ SoftwareRenderBackend::SoftwareRenderBackend(SDL_Window* pWindow) :
 	//Create Buffers
 	m_pFrontBuffer = SDL_GetWindowSurface(pWindow);
 	m_pBackBuffer = SDL_CreateRGBSurface(0, m_Width, m_Height, 32, 0, 0, 0, 0);
-	m_pBackBufferPixels = (uint32_t*)m_pBackBuffer->pixels;
 
-	m_pDepthBufferPixels = new float[m_Width * m_Height] { FLT_MAX };
+	// With 8 bits per channel and no palette, SDL_MapRGB comes down to shifting the channels into place
+	const SDL_PixelFormat* pFormat{ m_pBackBuffer->format };
+	m_CanPackColors = pFormat->BytesPerPixel == 4 && !pFormat->palette && pFormat->Rloss == 0 && pFormat->Gloss == 0 && pFormat->Bloss == 0;
+	m_RedShift = pFormat->Rshift;
+	m_GreenShift = pFormat->Gshift;
+	m_BlueShift = pFormat->Bshift;
+	m_AlphaMask = pFormat->Amask;
+
+	m_Layout = PixelLayout{ layout, m_Width, m_Height };
+
+	// A linear layout matches the surface, so there is nothing to resolve
+	if (layout == PixelLayout::Type::linear) {
+		m_pBackBufferPixels = (uint32_t*)m_pBackBuffer->pixels;
+	} else {
+		m_SwizzledColorBuffer.resize(m_Layout.GetSize());
+		m_pBackBufferPixels = m_SwizzledColorBuffer.data();
+	}
+
+	m_pDepthBufferPixels = new float[m_Layout.GetSize()] { FLT_MAX };
+	m_VisibilityBuffer.resize(m_Layout.GetSize());
+
+	// Screen tiles for the binned renderer
+	m_TilesX = (m_Width + TILE_SIZE - 1) / TILE_SIZE;
+	m_TilesY = (m_Height + TILE_SIZE - 1) / TILE_SIZE;
+	m_TileBins.resize(static_cast<size_t>(m_TilesX) * m_TilesY);
+
+	// Nearest and farthest depth per Hi-Z tile
+	m_HiZWidth = (m_Width + HIZ_TILE_SIZE - 1) / HIZ_TILE_SIZE;
+	m_HiZHeight = (m_Height + HIZ_TILE_SIZE - 1) / HIZ_TILE_SIZE;
+	m_HiZMin.resize(static_cast<size_t>(m_HiZWidth) * m_HiZHeight);
+	m_HiZMax.resize(static_cast<size_t>(m_HiZWidth) * m_HiZHeight);
+	m_TileEpochs.resize(static_cast<size_t>(m_HiZWidth) * m_HiZHeight);
+
+	// Guard band planes, converted from pixels to normalized device coordinates
+	m_GuardBandX = 1.f + 2.f * GUARD_BAND / m_Width;
+	m_GuardBandY = 1.f + 2.f * GUARD_BAND / m_Height;
+
+	SetThreadCount(threadCount);
 }
 
 SoftwareRenderBackend::~SoftwareRenderBackend()
@@ -40,23 +81,84 @@ void SoftwareRenderBackend::Render(const Camera& camera, std::vector<Mesh*>& mes
 	//Lock BackBuffer
 	SDL_LockSurface(m_pBackBuffer);
 
-	// Reset screen to default
-	std::fill_n(m_pDepthBufferPixels, m_Width * m_Height, FLT_MAX);
-	std::fill_n(m_pBackBufferPixels, m_Width * m_Height, SDL_MapRGB(m_pBackBuffer->format,
-																																	static_cast<uint8_t>(m_BackgroundColor.r * 255),
-																																	static_cast<uint8_t>(m_BackgroundColor.b * 255),
-																																	static_cast<uint8_t>(m_BackgroundColor.g * 255)));
+	// Reset screen to default, the color and depth of a tile only get cleared once the tile is used
+	++m_FrameEpoch;
+	m_ClearColor = PackColor(m_BackgroundColor);
+
+	std::fill(m_HiZMin.begin(), m_HiZMin.end(), FLT_MAX);
+	std::fill(m_HiZMax.begin(), m_HiZMax.end(), FLT_MAX);
+
+	m_PixelsTested = 0;
+	m_PixelsWritten = 0;
+	m_PixelsShaded = 0;
+	m_BlocksRejected = 0;
+	m_TrianglesRejected = 0;
+	m_TrianglesSubmitted = 0;
+	m_TrianglesClipped = 0;
+	m_VerticesTransformed = 0;
+	m_VerticesShaded = 0;
+	m_MeshletsCulled = 0;
+	m_MeshesReused = 0;
+
+	// Fragments only interpolate what the view and shading mode read
+	m_Varyings = GetVaryings();
+	m_MaterialStreams = GetMaterialStreams();
+	m_CameraOrigin = camera.origin;
+
+	m_Triangles.clear();
+	m_ClippedVertices.clear();
+	for (std::vector<uint32_t>& bin : m_TileBins) {
+		bin.clear();
+	}
 
 	//RENDER LOGICs
-	for (Mesh* mesh : meshes) {
-		if (!mesh->CanBeSoftwareRendered() || !mesh->Visible()) {
-			continue;
+	VertexTransformationFunction(camera, meshes);
+
+	for (MeshVertices& meshVertices : m_MeshVertices) {
+		RenderMesh(camera, meshVertices);
+	}
+
+	// The pre-pass fills in the final depth, so the shading pass only shades the visible triangle of every pixel
+	const RasterPass shadePass{ m_DepthPrepassEnabled ? RasterPass::shadeEqualDepth : RasterPass::shade };
+
+	// When binning, the triangles only got sorted into tiles so far
+	if (m_pThreadPool) {
+		if (m_DepthPrepassEnabled) {
+			m_pThreadPool->ParallelFor(m_TileBins.size(), [this](size_t tileIndex) {
+				RenderTile(tileIndex, RasterPass::depthOnly);
+			});
+		}
+
+		m_pThreadPool->ParallelFor(m_TileBins.size(), [this, shadePass](size_t tileIndex) {
+			RenderTile(tileIndex, shadePass);
+		});
+	} else if (m_DepthPrepassEnabled) {
+		for (const TriangleSetup& triangle : m_Triangles) {
+			RenderTriangle(triangle, 0, 0, m_Width, m_Height, RasterPass::depthOnly);
 		}
 
-		VertexTransformationFunction(camera, mesh);
-		RenderMesh(camera, mesh);
+		for (const TriangleSetup& triangle : m_Triangles) {
+			RenderTriangle(triangle, 0, 0, m_Width, m_Height, shadePass);
+		}
 	}
 
+	// Every visible pixel is shaded exactly once, no matter how many triangles got drawn over it
+	if (m_DeferredShading) {
+		if (m_pThreadPool) {
+			m_pThreadPool->ParallelFor(static_cast<size_t>(m_Height), [this](size_t py) {
+				ShadeVisibleRow(static_cast<int>(py));
+			});
+		} else {
+			for (int py{}; py < m_Height; ++py) {
+				ShadeVisibleRow(py);
+			}
+		}
+	} else {
+		m_PixelsShaded = m_PixelsWritten.load();
+	}
+
+	ResolveColorBuffer();
+
 	//@END
 	//Update SDL Surface
 	SDL_UnlockSurface(m_pBackBuffer);
@@ -64,53 +166,229 @@ void SoftwareRenderBackend::Render(const Camera& camera, std::vector<Mesh*>& mes
 	SDL_UpdateWindowSurface(m_pWindow);
 }
 
-void SoftwareRenderBackend::VertexTransformationFunction(const Camera& camera, Mesh* mesh) const
+void SoftwareRenderBackend::VertexTransformationFunction(const Camera& camera, const std::vector<Mesh*>& meshes)
 {
-	const std::vector<Vertex>& inputVertices = mesh->GetVertices();
-	auto& outVertices{ mesh->GetOutVerticesMutable() };
+	m_VertexChunks.clear();
 
-	const Matrix worldViewProjectionMatrix{ mesh->GetWorldMatrix() * camera.invViewMatrix * camera.projectionMatrix };
+	size_t meshCount{};
+	for (Mesh* mesh : meshes) {
+		if (!mesh->CanBeSoftwareRendered() || !mesh->Visible()) {
+			continue;
+		}
+
+		if (meshCount == m_MeshVertices.size()) {
+			m_MeshVertices.emplace_back();
+		}
+
+		MeshVertices& meshVertices{ m_MeshVertices[meshCount] };
+		const size_t vertexCount{ mesh->GetVertexCount() };
+		const bool cullsMeshlets{ m_MeshletCullingEnabled && !mesh->GetMeshlets().empty() && mesh->GetCullMode() != Mesh::CullMode::None };
 
-	for (size_t index{}; index < inputVertices.size(); ++index) {
-		OutVertex& outVertex{ outVertices[index] };
-		outVertex.position = worldViewProjectionMatrix.TransformPoint(inputVertices[index].position.ToPoint4());
+		const bool worldUnchanged{ meshVertices.pMesh == mesh && meshVertices.worldMatrixVersion == mesh->GetWorldMatrixVersion() };
+		const bool viewUnchanged{ meshVertices.pCamera == &camera && meshVertices.cameraVersion == camera.version };
 
-		outVertex.position.x /= outVertex.position.w;
-		outVertex.position.y /= outVertex.position.w;
-		outVertex.position.z /= outVertex.position.w;
+		// The out vertices and surviving triangles of the last frame are still exactly what this frame would compute
+		// Such a mesh gets no chunks and keeps its triangles, so it is left out of transforming, culling and shading alike
+		meshVertices.reused = worldUnchanged && viewUnchanged && meshVertices.cullsMeshlets == cullsMeshlets && meshVertices.cullMode == mesh->GetCullMode();
+		if (meshVertices.reused) {
+			++m_MeshesReused;
+			++meshCount;
+			continue;
+		}
 
-		// Convert from ndc to screenspace position
-		outVertex.position.x = ((outVertex.position.x + 1) / 2) * m_Width;
-		outVertex.position.y = ((1 - outVertex.position.y) / 2) * m_Height;
+		if (!worldUnchanged) {
+			meshVertices.worldShadedVertices.assign((vertexCount + 63) / 64, 0);
+		}
 
-		outVertex.color = inputVertices[index].color;
-		outVertex.uv = inputVertices[index].uv;
-		outVertex.normal = mesh->GetWorldMatrix().TransformVector(inputVertices[index].normal).Normalized();
-		outVertex.tangent = mesh->GetWorldMatrix().TransformVector(inputVertices[index].tangent).Normalized();
-		outVertex.viewDirection = (camera.origin - mesh->GetWorldMatrix().TransformPoint(inputVertices[index].position)).Normalized();
+		meshVertices.pMesh = mesh;
+		meshVertices.worldMatrixVersion = mesh->GetWorldMatrixVersion();
+		meshVertices.pCamera = &camera;
+		meshVertices.cameraVersion = camera.version;
+		meshVertices.cullMode = mesh->GetCullMode();
+		meshVertices.transform = {
+			mesh->GetWorldMatrix(),
+			mesh->GetWorldMatrix() * camera.invViewMatrix * camera.projectionMatrix,
+			camera.origin,
+			static_cast<float>(m_Width),
+			static_cast<float>(m_Height)
+		};
+
+		meshVertices.clipPositions.resize(vertexCount);
+		meshVertices.clipCodes.resize(vertexCount);
+		meshVertices.shadedVertices.assign((vertexCount + 63) / 64, 0);
+		meshVertices.triangles.clear();
+
+		// Back facing clusters are rejected before any vertex work
+		meshVertices.cullsMeshlets = cullsMeshlets;
+		if (meshVertices.cullsMeshlets) {
+			CullMeshlets(meshVertices);
+		}
+
+		VertexStage::AppendChunks(meshCount, vertexCount, m_VertexChunks);
+		++meshCount;
+	}
+
+	m_MeshVertices.resize(meshCount);
+
+	// Every out vertex only depends on its own input vertex, so chunks of all meshes get transformed at the same time
+	// Positions come first, the other attributes are only needed for the vertices of triangles that survive culling
+	if (m_pThreadPool) {
+		m_pThreadPool->ParallelFor(m_VertexChunks.size(), [this](size_t chunkIndex) {
+			TransformChunk(m_VertexChunks[chunkIndex]);
+		});
+
+		m_pThreadPool->ParallelFor(m_MeshVertices.size(), [this](size_t meshIndex) {
+			if (!m_MeshVertices[meshIndex].reused) {
+				CullTriangles(m_MeshVertices[meshIndex]);
+			}
+		});
+
+		m_pThreadPool->ParallelFor(m_VertexChunks.size(), [this](size_t chunkIndex) {
+			ShadeChunk(m_VertexChunks[chunkIndex]);
+		});
+	} else {
+		for (const VertexStage::Chunk& chunk : m_VertexChunks) {
+			TransformChunk(chunk);
+		}
+
+		for (MeshVertices& meshVertices : m_MeshVertices) {
+			if (!meshVertices.reused) {
+				CullTriangles(meshVertices);
+			}
+		}
+
+		for (const VertexStage::Chunk& chunk : m_VertexChunks) {
+			ShadeChunk(chunk);
+		}
 	}
 }
 
-void dae::SoftwareRenderBackend::RenderMesh(const Camera& camera, const Mesh* mesh) {
-	auto& vertices = mesh->GetOutVertices();
+void dae::SoftwareRenderBackend::CullMeshlets(MeshVertices& meshVertices) {
+	const Mesh* mesh{ meshVertices.pMesh };
+	const Matrix& worldMatrix{ meshVertices.transform.world };
+
+	const std::vector<Meshlet>& meshlets{ mesh->GetMeshlets() };
+	const std::vector<uint32_t>& meshletVertices{ mesh->GetMeshletVertices() };
+
+	// Front face culling rejects clusters that face the camera instead
+	const float coneSign{ mesh->GetCullMode() == Mesh::CullMode::FrontFace ? -1.f : 1.f };
+	const Vector3 axisX{ worldMatrix.GetAxisX() };
+	const Vector3 axisY{ worldMatrix.GetAxisY() };
+	const Vector3 axisZ{ worldMatrix.GetAxisZ() };
+	const float scale{ std::max({ axisX.Magnitude(), axisY.Magnitude(), axisZ.Magnitude() }) };
+
+	// A non-uniform scale or shear changes the angles between the normals, the cones then no longer bound them
+	const float tolerance{ 1e-4f * scale * scale };
+	const bool keepsAngles{
+		std::abs(axisX.SqrMagnitude() - axisY.SqrMagnitude()) <= tolerance && std::abs(axisX.SqrMagnitude() - axisZ.SqrMagnitude()) <= tolerance &&
+		std::abs(Vector3::Dot(axisX, axisY)) <= tolerance && std::abs(Vector3::Dot(axisX, axisZ)) <= tolerance && std::abs(Vector3::Dot(axisY, axisZ)) <= tolerance
+	};
+
+	meshVertices.visibleMeshlets.clear();
+	meshVertices.transformedVertices.assign(meshVertices.shadedVertices.size(), 0);
+
+	for (uint32_t meshletIndex{}; meshletIndex < meshlets.size(); ++meshletIndex) {
+		const Meshlet& meshlet{ meshlets[meshletIndex] };
+
+		// Every triangle is back facing when the camera lies inside of the cone behind the bounding sphere
+		if (keepsAngles && meshlet.coneCutoff < 1.f) {
+			const Vector3 center{ worldMatrix.TransformPoint(meshlet.center) };
+			const Vector3 coneAxis{ worldMatrix.TransformVector(meshlet.coneAxis).Normalized() * coneSign };
+			const Vector3 toCenter{ center - meshVertices.transform.cameraOrigin };
+
+			if (Vector3::Dot(toCenter, coneAxis) >= meshlet.coneCutoff * toCenter.Magnitude() + meshlet.radius * scale) {
+				++m_MeshletsCulled;
+				continue;
+			}
+		}
+
+		meshVertices.visibleMeshlets.push_back(meshletIndex);
 
-	switch (mesh->GetTopology()) {
+		for (uint32_t index{ meshlet.vertexOffset }; index < meshlet.vertexOffset + meshlet.vertexCount; ++index) {
+			const uint32_t vertexIndex{ meshletVertices[index] };
+			meshVertices.transformedVertices[vertexIndex / 64] |= uint64_t{ 1 } << (vertexIndex % 64);
+		}
+	}
+}
+
+size_t dae::SoftwareRenderBackend::GetSetBits(const std::vector<uint64_t>& bits, const VertexStage::Chunk& chunk, uint32_t* pIndices) {
+	size_t count{};
+
+	for (size_t wordIndex{ chunk.begin / 64 }; wordIndex * 64 < chunk.end; ++wordIndex) {
+		uint64_t word{ bits[wordIndex] };
+
+		while (word) {
+			pIndices[count++] = static_cast<uint32_t>(wordIndex * 64 + std::countr_zero(word));
+			word &= word - 1;
+		}
+	}
+
+	return count;
+}
+
+void dae::SoftwareRenderBackend::TransformChunk(const VertexStage::Chunk& chunk) {
+	MeshVertices& meshVertices{ m_MeshVertices[chunk.meshIndex] };
+	OutVertex* pOutVertices{ meshVertices.pMesh->GetOutVerticesMutable().data() };
+
+	if (!meshVertices.cullsMeshlets) {
+		VertexStage::TransformPositionsSimd(*meshVertices.pMesh, meshVertices.transform, pOutVertices, meshVertices.clipPositions.data(), chunk.begin, chunk.end);
+
+		for (size_t index{ chunk.begin }; index < chunk.end; ++index) {
+			meshVertices.clipCodes[index] = GetClipCode(meshVertices.clipPositions[index]);
+		}
+
+		m_VerticesTransformed += chunk.end - chunk.begin;
+		return;
+	}
+
+	// Only the vertices of the visible meshlets, chunks start at a multiple of 64 so they cover whole words of the bitset
+	// Like in ShadeChunk, every thread keeps one buffer of indices for all of the chunks it transforms
+	thread_local std::vector<uint32_t> indexBuffer(VertexStage::CHUNK_SIZE);
+	const uint32_t* indices{ indexBuffer.data() };
+	const size_t count{ GetSetBits(meshVertices.transformedVertices, chunk, indexBuffer.data()) };
+
+	VertexStage::TransformPositionsSimd(*meshVertices.pMesh, meshVertices.transform, pOutVertices, meshVertices.clipPositions.data(), indices, count);
+
+	for (size_t index{}; index < count; ++index) {
+		meshVertices.clipCodes[indices[index]] = GetClipCode(meshVertices.clipPositions[indices[index]]);
+	}
+
+	m_VerticesTransformed += count;
+}
+
+void dae::SoftwareRenderBackend::CullTriangles(MeshVertices& meshVertices) {
+	const std::vector<uint32_t>& indices = meshVertices.pMesh->GetIndices();
+
+	// Meshlets hold consecutive triangles, so the visible ones still come in index buffer order
+	if (meshVertices.cullsMeshlets) {
+		const std::vector<Meshlet>& meshlets{ meshVertices.pMesh->GetMeshlets() };
+
+		for (uint32_t meshletIndex : meshVertices.visibleMeshlets) {
+			const Meshlet& meshlet{ meshlets[meshletIndex] };
+
+			for (uint32_t triangle{ meshlet.triangleOffset }; triangle < meshlet.triangleOffset + meshlet.triangleCount; ++triangle) {
+				CullTriangle(meshVertices, indices[triangle * 3], indices[triangle * 3 + 1], indices[triangle * 3 + 2]);
+			}
+		}
+
+		return;
+	}
+
+	switch (meshVertices.pMesh->GetTopology()) {
 		case Mesh::PrimitiveTopology::TriangleStrip:
 		{
-			const std::vector<uint32_t>& indices = mesh->GetIndices();
-
 			for (size_t index{}; index < indices.size() - 2; ++index) {
 				bool uneven{ static_cast<bool>(index & 1) };
 
-				OutVertex v0{ vertices[indices[index]] };
-				OutVertex v1{ vertices[indices[index + 1]] };
-				OutVertex v2{ vertices[indices[index + 2]] };
+				const uint32_t index0{ indices[index] };
+				uint32_t index1{ indices[index + 1] };
+				uint32_t index2{ indices[index + 2] };
 
 				if (!uneven) {
-					std::swap(v1, v2);
+					std::swap(index1, index2);
 				}
 
-				RenderTriangle(camera, mesh, v0, v1, v2);
+				CullTriangle(meshVertices, index0, index1, index2);
 			}
 
 			break;
@@ -118,10 +396,8 @@ void dae::SoftwareRenderBackend::RenderMesh(const Camera& camera, const Mesh* me
 
 		default:
 		{
-			const std::vector<uint32_t>& indices = mesh->GetIndices();
-
 			for (size_t index{}; index < indices.size(); index += 3) {
-				RenderTriangle(camera, mesh, vertices[indices[index]], vertices[indices[index + 1]], vertices[indices[index + 2]]);
+				CullTriangle(meshVertices, indices[index], indices[index + 1], indices[index + 2]);
 			}
 
 			break;
@@ -129,30 +405,259 @@ void dae::SoftwareRenderBackend::RenderMesh(const Camera& camera, const Mesh* me
 	}
 }
 
-void dae::SoftwareRenderBackend::RenderTriangle(const Camera& camera, const Mesh* mesh, const OutVertex& v0, const OutVertex& v1, const OutVertex& v2) {	
-	if (v0.position == v1.position || v1.position == v2.position || v2.position == v0.position) {
+void dae::SoftwareRenderBackend::CullTriangle(MeshVertices& meshVertices, uint32_t index0, uint32_t index1, uint32_t index2) {
+	const uint8_t clipCode0{ meshVertices.clipCodes[index0] };
+	const uint8_t clipCode1{ meshVertices.clipCodes[index1] };
+	const uint8_t clipCode2{ meshVertices.clipCodes[index2] };
+
+	// All vertices lie outside of the same plane
+	if ((clipCode0 & clipCode1 & clipCode2) != 0) {
 		return;
 	}
 
-	if (!(v0.position.z > 0 && v0.position.z < 1) || !(v1.position.z > 0 && v1.position.z < 1) || !(v2.position.z > 0 && v2.position.z < 1)) {
+	CulledTriangle triangle{};
+	triangle.indices[0] = index0;
+	triangle.indices[1] = index1;
+	triangle.indices[2] = index2;
+
+	// Inside of the depth range and the guard band, the setup only needs the screen space positions to cull the triangle
+	// Triangles that get clipped are kept as they are, the polygon is only known after shading their vertices
+	triangle.needsClipping = (clipCode0 | clipCode1 | clipCode2) != 0;
+
+	if (!triangle.needsClipping) {
+		const std::vector<OutVertex>& vertices{ meshVertices.pMesh->GetOutVertices() };
+
+		if (!SetupTriangle(meshVertices.pMesh, vertices[index0], vertices[index1], vertices[index2], triangle.setup)) {
+			return;
+		}
+	}
+
+	for (uint32_t index : triangle.indices) {
+		meshVertices.shadedVertices[index / 64] |= uint64_t{ 1 } << (index % 64);
+	}
+
+	meshVertices.triangles.push_back(triangle);
+}
+
+void dae::SoftwareRenderBackend::ShadeChunk(const VertexStage::Chunk& chunk) {
+	MeshVertices& meshVertices{ m_MeshVertices[chunk.meshIndex] };
+	OutVertex* pOutVertices{ meshVertices.pMesh->GetOutVerticesMutable().data() };
+
+	// A whole chunk of indices is too much for the stack, every thread keeps one buffer for all of the chunks it shades
+	thread_local std::vector<uint32_t> indexBuffer(VertexStage::CHUNK_SIZE);
+	uint32_t* indices{ indexBuffer.data() };
+	const size_t count{ GetSetBits(meshVertices.shadedVertices, chunk, indices) };
+
+	// Vertices shaded in an earlier frame still have valid attributes, none of them depend on the camera
+	std::vector<uint64_t>& worldShadedVertices{ meshVertices.worldShadedVertices };
+	const uint32_t* pIndicesEnd{ std::remove_if(indices, indices + count, [&worldShadedVertices](uint32_t index) {
+		return (worldShadedVertices[index / 64] & (uint64_t{ 1 } << (index % 64))) != 0;
+	}) };
+
+	const size_t shadeCount{ static_cast<size_t>(pIndicesEnd - indices) };
+	VertexStage::ShadeVerticesSimd(*meshVertices.pMesh, meshVertices.transform, pOutVertices, indices, shadeCount);
+
+	// The chunk covers whole words, so no other thread touches these bits
+	for (size_t index{}; index < shadeCount; ++index) {
+		worldShadedVertices[indices[index] / 64] |= uint64_t{ 1 } << (indices[index] % 64);
+	}
+
+	m_VerticesShaded += shadeCount;
+}
+
+Vector4 dae::SoftwareRenderBackend::ToScreenSpace(const Vector4& clipPosition) const {
+	return VertexStage::ToScreenSpace(clipPosition, static_cast<float>(m_Width), static_cast<float>(m_Height));
+}
+
+uint8_t dae::SoftwareRenderBackend::GetClipCode(const Vector4& clipPosition) const {
+	uint8_t clipCode{};
+
+	for (int planeIndex{}; planeIndex < CLIP_PLANE_COUNT; ++planeIndex) {
+		if (GetClipDistance(clipPosition, planeIndex) < 0) {
+			clipCode |= 1 << planeIndex;
+		}
+	}
+
+	return clipCode;
+}
+
+float dae::SoftwareRenderBackend::GetClipDistance(const Vector4& clipPosition, int planeIndex) const {
+	// Positive inside of the plane, the depth range is 0 <= z <= w
+	switch (1 << planeIndex) {
+		case nearPlane:
+			return clipPosition.z;
+		case farPlane:
+			return clipPosition.w - clipPosition.z;
+		case leftPlane:
+			return clipPosition.x + m_GuardBandX * clipPosition.w;
+		case rightPlane:
+			return m_GuardBandX * clipPosition.w - clipPosition.x;
+		case bottomPlane:
+			return clipPosition.y + m_GuardBandY * clipPosition.w;
+		default:
+			return m_GuardBandY * clipPosition.w - clipPosition.y;
+	}
+}
+
+void dae::SoftwareRenderBackend::RenderMesh(const Camera& camera, MeshVertices& meshVertices) {
+	m_TrianglesSubmitted += meshVertices.triangles.size();
+
+	for (CulledTriangle& triangle : meshVertices.triangles) {
+		if (triangle.needsClipping) {
+			ClipTriangle(meshVertices, triangle.indices[0], triangle.indices[1], triangle.indices[2]);
+		} else {
+			SubmitTriangle(triangle.setup);
+		}
+	}
+}
+
+void dae::SoftwareRenderBackend::ClipTriangle(const MeshVertices& meshVertices, uint32_t index0, uint32_t index1, uint32_t index2) {
+	const Mesh* mesh{ meshVertices.pMesh };
+	const std::vector<OutVertex>& vertices{ mesh->GetOutVertices() };
+
+	const uint8_t clipCode0{ meshVertices.clipCodes[index0] };
+	const uint8_t clipCode1{ meshVertices.clipCodes[index1] };
+	const uint8_t clipCode2{ meshVertices.clipCodes[index2] };
+
+	++m_TrianglesClipped;
+
+	// Attributes are still linear in clip space, so the polygon is clipped before the perspective divide
+	OutVertex polygon[MAX_CLIPPED_VERTICES]{};
+	OutVertex clippedPolygon[MAX_CLIPPED_VERTICES]{};
+	int vertexCount{ 3 };
+
+	const uint32_t indices[3]{ index0, index1, index2 };
+	for (int index{}; index < 3; ++index) {
+		polygon[index] = vertices[indices[index]];
+		polygon[index].position = meshVertices.clipPositions[indices[index]];
+	}
+
+	// Always interpolates from the inside vertex, so triangles sharing the edge get the exact same intersection
+	const auto intersect = [](const OutVertex& inside, const OutVertex& outside, float insideDistance, float outsideDistance) {
+		const float t{ insideDistance / (insideDistance - outsideDistance) };
+
+		OutVertex vertex{};
+		vertex.position = inside.position + (outside.position - inside.position) * t;
+		vertex.uv = inside.uv + (outside.uv - inside.uv) * t;
+		vertex.normal = inside.normal + (outside.normal - inside.normal) * t;
+		vertex.tangent = inside.tangent + (outside.tangent - inside.tangent) * t;
+		vertex.worldPosition = inside.worldPosition + (outside.worldPosition - inside.worldPosition) * t;
+		return vertex;
+	};
+
+	// Sutherland-Hodgman, only against the planes that the triangle crosses
+	const uint8_t crossedPlanes{ static_cast<uint8_t>(clipCode0 | clipCode1 | clipCode2) };
+
+	for (int planeIndex{}; planeIndex < CLIP_PLANE_COUNT; ++planeIndex) {
+		if (!(crossedPlanes & (1 << planeIndex))) {
+			continue;
+		}
+
+		int clippedCount{};
+
+		for (int index{}; index < vertexCount; ++index) {
+			const OutVertex& current{ polygon[index] };
+			const OutVertex& next{ polygon[(index + 1) % vertexCount] };
+
+			const float currentDistance{ GetClipDistance(current.position, planeIndex) };
+			const float nextDistance{ GetClipDistance(next.position, planeIndex) };
+
+			if (currentDistance >= 0) {
+				clippedPolygon[clippedCount++] = current;
+			}
+
+			if ((currentDistance >= 0) != (nextDistance >= 0)) {
+				clippedPolygon[clippedCount++] = currentDistance >= 0 ?
+					intersect(current, next, currentDistance, nextDistance) :
+					intersect(next, current, nextDistance, currentDistance);
+			}
+		}
+
+		std::copy(clippedPolygon, clippedPolygon + clippedCount, polygon);
+		vertexCount = clippedCount;
+
+		if (vertexCount < 3) {
+			return;
+		}
+	}
+
+	const size_t firstIndex{ m_ClippedVertices.size() };
+	for (int index{}; index < vertexCount; ++index) {
+		OutVertex& vertex{ m_ClippedVertices.emplace_back(polygon[index]) };
+		vertex.position = ToScreenSpace(vertex.position);
+	}
+
+	// The clipped polygon is convex, so it can be fanned out from its first vertex
+	for (int index{ 1 }; index < vertexCount - 1; ++index) {
+		SubmitTriangle(mesh, m_ClippedVertices[firstIndex], m_ClippedVertices[firstIndex + index], m_ClippedVertices[firstIndex + index + 1]);
+	}
+}
+
+void dae::SoftwareRenderBackend::SubmitTriangle(const Mesh* mesh, const OutVertex& v0, const OutVertex& v1, const OutVertex& v2) {
+	TriangleSetup triangle{};
+	if (SetupTriangle(mesh, v0, v1, v2, triangle)) {
+		SubmitTriangle(triangle);
+	}
+}
+
+void dae::SoftwareRenderBackend::SubmitTriangle(TriangleSetup& triangle) {
+	AttributeSetup::Setup(*triangle.v0, *triangle.v1, *triangle.v2, triangle.weights, m_Varyings, triangle.attributes);
+
+	if (m_pThreadPool) {
+		BinTriangle(triangle);
 		return;
 	}
 
-	const Vector2 t0{ v0.position.GetXY() };
-	const Vector2 t1{ v1.position.GetXY() };
-	const Vector2 t2{ v2.position.GetXY() };
+	// The visibility buffer refers to triangles by their index, and the pre-pass needs all of them before shading
+	if (m_DeferredShading || m_DepthPrepassEnabled) {
+		triangle.id = static_cast<uint32_t>(m_Triangles.size());
+		m_Triangles.push_back(triangle);
+	}
 
-	Vector2 edge0{ t1 - t0 };
-	Vector2 edge1{ t2 - t1 };
-	Vector2 edge2{ t0 - t2 };
+	if (!m_DepthPrepassEnabled) {
+		RenderTriangle(triangle, 0, 0, m_Width, m_Height, RasterPass::shade);
+	}
+}
+
+bool dae::SoftwareRenderBackend::SetupTriangle(const Mesh* mesh, const OutVertex& v0, const OutVertex& v1, const OutVertex& v2, TriangleSetup& triangle) const {
+	if (v0.position == v1.position || v1.position == v2.position || v2.position == v0.position) {
+		return false;
+	}
+
+	triangle.mesh = mesh;
+	triangle.v0 = &v0;
+	triangle.v1 = &v1;
+	triangle.v2 = &v2;
+
+	const OutVertex* vertices[3]{ &v0, &v1, &v2 };
 
-	const float normMagnitude{ Vector2::Cross(edge0, t2 - t0) };
+	// Snap the vertices to the subpixel grid
+	int64_t fixedX[3]{};
+	int64_t fixedY[3]{};
+
+	for (int index{}; index < 3; ++index) {
+		const Vector4& position{ vertices[index]->position };
+
+		if (!(std::abs(position.x) < FIXED_POINT_LIMIT && std::abs(position.y) < FIXED_POINT_LIMIT)) {
+			return false;
+		}
+
+		fixedX[index] = std::lround(position.x * SUBPIXEL_SCALE);
+		fixedY[index] = std::lround(position.y * SUBPIXEL_SCALE);
+	}
+
+	const int64_t normMagnitude{ (fixedX[1] - fixedX[0]) * (fixedY[2] - fixedY[0]) - (fixedY[1] - fixedY[0]) * (fixedX[2] - fixedX[0]) };
+
+	// Degenerate after snapping, covers no pixel centers
+	if (normMagnitude == 0) {
+		return false;
+	}
 
 	switch (mesh->GetCullMode()) {
 		case Mesh::CullMode::BackFace:
 		{
-			if (normMagnitude < 0.0f) {
-				return;
+			if (normMagnitude < 0) {
+				return false;
 			};
 
 			break;
@@ -160,8 +665,8 @@ void dae::SoftwareRenderBackend::RenderTriangle(const Camera& camera, const Mesh
 
 		case Mesh::CullMode::FrontFace:
 		{
-			if (normMagnitude > 0.0f) {
-				return;
+			if (normMagnitude > 0) {
+				return false;
 			};
 
 			break;
@@ -172,169 +677,840 @@ void dae::SoftwareRenderBackend::RenderTriangle(const Camera& camera, const Mesh
 			break;
 	}
 
+	// Flip the edge functions of counter clockwise triangles so the inside is always positive
+	const int64_t orientation{ normMagnitude > 0 ? 1 : -1 };
+
+	for (int index{}; index < 3; ++index) {
+		const int start{ (index + 1) % 3 };
+		const int end{ (index + 2) % 3 };
+
+		const int64_t deltaX{ (fixedX[end] - fixedX[start]) * orientation };
+		const int64_t deltaY{ (fixedY[end] - fixedY[start]) * orientation };
+
+		// Top-left fill rule, pixel centers exactly on an edge only belong to the triangle if it is a top or left edge
+		const bool isTopLeft{ deltaY < 0 || (deltaY == 0 && deltaX > 0) };
+		triangle.edgeBias[index] = isTopLeft ? 0 : -1;
 
-	const float invMagnitude{ 1 / normMagnitude };
+		// Edge function relative to the first pixel center, stepping a whole pixel at a time
+		const int64_t halfPixel{ SUBPIXEL_SCALE / 2 };
+		triangle.edgeOrigin[index] = deltaX * (halfPixel - fixedY[start]) - deltaY * (halfPixel - fixedX[start]) + triangle.edgeBias[index];
+		triangle.edgeStepX[index] = -deltaY * SUBPIXEL_SCALE;
+		triangle.edgeStepY[index] = deltaX * SUBPIXEL_SCALE;
+	}
+
+	// Interpolated depths stay between the vertex depths, up to rounding of the weights
+	triangle.nearestZ = std::min({ v0.position.z, v1.position.z, v2.position.z }) * (1.f - HIZ_EPSILON);
+	triangle.farthestZ = std::max({ v0.position.z, v1.position.z, v2.position.z }) * (1.f + HIZ_EPSILON);
 
-	// Calculate triangle bounding box in screen space
-	float minX = std::min({ v0.position.x, v1.position.x, v2.position.x });
-	float minY = std::min({ v0.position.y, v1.position.y, v2.position.y });
-	float maxX = std::max({ v0.position.x, v1.position.x, v2.position.x });
-	float maxY = std::max({ v0.position.y, v1.position.y, v2.position.y });
+	// Small enough triangles fit the 32 bit lanes of the block rasterizer
+	triangle.allowBlocks = normMagnitude * orientation < BLOCK_EDGE_LIMIT;
+	for (int index{}; index < 3; ++index) {
+		if (std::abs(triangle.edgeStepX[index]) * (BLOCK_WIDTH - 1) + std::abs(triangle.edgeStepY[index]) * (BLOCK_HEIGHT - 1) >= BLOCK_EDGE_LIMIT) {
+			triangle.allowBlocks = false;
+		}
+	}
+
+	// Calculate triangle bounding box in pixel centers
+	const int64_t minX{ std::min({ fixedX[0], fixedX[1], fixedX[2] }) };
+	const int64_t minY{ std::min({ fixedY[0], fixedY[1], fixedY[2] }) };
+	const int64_t maxX{ std::max({ fixedX[0], fixedX[1], fixedX[2] }) };
+	const int64_t maxY{ std::max({ fixedY[0], fixedY[1], fixedY[2] }) };
 
 	// Clamp bounding box to screen dimensions
-	int startX = std::max(static_cast<int>(std::floor(minX)), 0);
-	int startY = std::max(static_cast<int>(std::floor(minY)), 0);
-	int endX = std::min(static_cast<int>(std::ceil(maxX)), m_Width);
-	int endY = std::min(static_cast<int>(std::ceil(maxY)), m_Height);
+	triangle.startX = static_cast<int>(std::max<int64_t>((minX - SUBPIXEL_SCALE / 2 + SUBPIXEL_SCALE - 1) >> SUBPIXEL_BITS, 0));
+	triangle.startY = static_cast<int>(std::max<int64_t>((minY - SUBPIXEL_SCALE / 2 + SUBPIXEL_SCALE - 1) >> SUBPIXEL_BITS, 0));
+	triangle.endX = static_cast<int>(std::min<int64_t>(((maxX - SUBPIXEL_SCALE / 2) >> SUBPIXEL_BITS) + 1, m_Width));
+	triangle.endY = static_cast<int>(std::min<int64_t>(((maxY - SUBPIXEL_SCALE / 2) >> SUBPIXEL_BITS) + 1, m_Height));
 
-	for (int py{ startY }; py < endY; ++py) {
-		for (int px{ startX }; px < endX; ++px) {
-			if (m_ShowBoundingBox) {
-				// Fill the bounding box with white
-				m_pBackBufferPixels[px + (py * m_Width)] = SDL_MapRGB(m_pBackBuffer->format,
-																															static_cast<uint8_t>(255),
-																															static_cast<uint8_t>(255),
-																															static_cast<uint8_t>(255));
+	if (triangle.startX >= triangle.endX || triangle.startY >= triangle.endY) {
+		return false;
+	}
+
+	// The weights follow from the fixed point edge functions at the anchor, so they match the coverage exactly
+	const float invMagnitude{ 1.f / static_cast<float>(normMagnitude * orientation) };
+
+	for (int index{}; index < 3; ++index) {
+		const int64_t anchorEdge{ triangle.edgeOrigin[index] + triangle.edgeStepX[index] * triangle.startX + triangle.edgeStepY[index] * triangle.startY - triangle.edgeBias[index] };
+
+		triangle.weights[index] = {
+			static_cast<float>(anchorEdge) * invMagnitude,
+			static_cast<float>(triangle.edgeStepX[index]) * invMagnitude,
+			static_cast<float>(triangle.edgeStepY[index]) * invMagnitude
+		};
+	}
+
+	triangle.depth = AttributeSetup::CreatePlane(triangle.weights, v0.position.z, v1.position.z, v2.position.z);
+
+	return true;
+}
+
+void dae::SoftwareRenderBackend::BinTriangle(const TriangleSetup& triangle) {
+	const uint32_t triangleIndex{ static_cast<uint32_t>(m_Triangles.size()) };
+	m_Triangles.push_back(triangle);
+	m_Triangles.back().id = triangleIndex;
+
+	const int startTileX{ triangle.startX / TILE_SIZE };
+	const int startTileY{ triangle.startY / TILE_SIZE };
+	const int endTileX{ (triangle.endX - 1) / TILE_SIZE };
+	const int endTileY{ (triangle.endY - 1) / TILE_SIZE };
+
+	for (int tileY{ startTileY }; tileY <= endTileY; ++tileY) {
+		for (int tileX{ startTileX }; tileX <= endTileX; ++tileX) {
+			m_TileBins[tileX + (tileY * m_TilesX)].push_back(triangleIndex);
+		}
+	}
+}
+
+void dae::SoftwareRenderBackend::RenderTile(size_t tileIndex, RasterPass pass) {
+	const int tileX{ static_cast<int>(tileIndex) % m_TilesX };
+	const int tileY{ static_cast<int>(tileIndex) / m_TilesX };
+
+	// The tile owns this part of the back and depth buffer, so no other thread touches it
+	const int minX{ tileX * TILE_SIZE };
+	const int minY{ tileY * TILE_SIZE };
+	const int maxX{ std::min(minX + TILE_SIZE, m_Width) };
+	const int maxY{ std::min(minY + TILE_SIZE, m_Height) };
+
+	// Same order as the triangles were submitted in, which keeps the output identical to the immediate renderer
+	for (uint32_t triangleIndex : m_TileBins[tileIndex]) {
+		RenderTriangle(m_Triangles[triangleIndex], minX, minY, maxX, maxY, pass);
+	}
+}
+
+void dae::SoftwareRenderBackend::RenderTriangle(const TriangleSetup& triangle, int minX, int minY, int maxX, int maxY, RasterPass pass) {
+	// Only rasterize the part of the bounding box inside the given region
+	const int startX{ std::max(triangle.startX, minX) };
+	const int startY{ std::max(triangle.startY, minY) };
+	const int endX{ std::min(triangle.endX, maxX) };
+	const int endY{ std::min(triangle.endY, maxY) };
+
+	if (startX >= endX || startY >= endY) {
+		return;
+	}
+
+	if (m_ShowBoundingBox) {
+		if (pass == RasterPass::depthOnly) {
+			return;
+		}
+
+		// Fill the bounding box with white
+		const uint32_t white{ PackColor(colors::White) };
+		ClearTiles(startX, startY, endX, endY);
+
+		for (int py{ startY }; py < endY; ++py) {
+			for (int px{ startX }; px < endX; ++px) {
+				m_pBackBufferPixels[m_Layout.GetIndex(px, py)] = white;
+			}
+		}
+
+		return;
+	}
+
+	switch (pass) {
+		case RasterPass::depthOnly:
+			if (triangle.allowBlocks) {
+				RenderTriangleBlocks<RasterPass::depthOnly>(triangle, startX, startY, endX, endY);
+			} else {
+				RenderTrianglePixels<RasterPass::depthOnly>(triangle, startX, startY, endX, endY);
+			}
+			break;
+
+		case RasterPass::shadeEqualDepth:
+			if (triangle.allowBlocks) {
+				RenderTriangleBlocks<RasterPass::shadeEqualDepth>(triangle, startX, startY, endX, endY);
+			} else {
+				RenderTrianglePixels<RasterPass::shadeEqualDepth>(triangle, startX, startY, endX, endY);
+			}
+			break;
+
+		default:
+			if (triangle.allowBlocks) {
+				RenderTriangleBlocks<RasterPass::shade>(triangle, startX, startY, endX, endY);
+			} else {
+				RenderTrianglePixels<RasterPass::shade>(triangle, startX, startY, endX, endY);
+			}
+			break;
+	}
+}
+
+template <dae::SoftwareRenderBackend::RasterPass pass>
+void dae::SoftwareRenderBackend::RenderTrianglePixels(const TriangleSetup& triangle, int startX, int startY, int endX, int endY) {
+	const int64_t stepX0{ triangle.edgeStepX[0] };
+	const int64_t stepX1{ triangle.edgeStepX[1] };
+	const int64_t stepX2{ triangle.edgeStepX[2] };
+
+	// Edge functions at the start of the current row
+	int64_t rowEdge0{ triangle.edgeOrigin[0] + triangle.edgeStepX[0] * startX + triangle.edgeStepY[0] * startY };
+	int64_t rowEdge1{ triangle.edgeOrigin[1] + triangle.edgeStepX[1] * startX + triangle.edgeStepY[1] * startY };
+	int64_t rowEdge2{ triangle.edgeOrigin[2] + triangle.edgeStepX[2] * startX + triangle.edgeStepY[2] * startY };
+
+	// The pixel loop doesn't track which tile it is in, so every tile of the bounding box gets cleared up front
+	ClearTiles(startX, startY, endX, endY);
+
+	// Large triangles skip the Hi-Z tests, their depth writes leave the farthest depth of a tile too high which is still safe
+	uint64_t pixelsTested{};
+	uint64_t pixelsWritten{};
+
+	for (int py{ startY }; py < endY; ++py, rowEdge0 += triangle.edgeStepY[0], rowEdge1 += triangle.edgeStepY[1], rowEdge2 += triangle.edgeStepY[2]) {
+		int64_t edge0{ rowEdge0 };
+		int64_t edge1{ rowEdge1 };
+		int64_t edge2{ rowEdge2 };
+
+		// Pixel position relative to the anchor of the planes
+		const float y{ static_cast<float>(py - triangle.startY) };
+
+		for (int px{ startX }; px < endX; ++px, edge0 += stepX0, edge1 += stepX1, edge2 += stepX2) {
+			// Outside if any of the (biased) edge functions is negative
+			if ((edge0 | edge1 | edge2) < 0) {
 				continue;
 			}
 
-			const Vector2 pixelCenter{ px + 0.5f, py + 0.5f };
+			const float x{ static_cast<float>(px - triangle.startX) };
+
+			// Clipping keeps the depth in [0, 1], where a depth of 0 lies on the near plane
+			const float interpolatedZ{ triangle.depth.At(x, y) };
+			if (interpolatedZ < 0 || interpolatedZ > 1) {
+				continue;
+			}
 
-			Vector2 toPFromV0{ pixelCenter - t0 };
-			Vector2 toPFromV1{ pixelCenter - t1 };
-			Vector2 toPFromV2{ pixelCenter - t2 };
+			++pixelsTested;
 
-			// Compute the weights
-			const float weight0 = Vector2::Cross(edge1, toPFromV1) * invMagnitude;
-			if (weight0 < 0.f) {
+			const float depth{ m_pDepthBufferPixels[m_Layout.GetIndex(px, py)] };
+			if (pass != RasterPass::shadeEqualDepth && interpolatedZ >= depth) {
 				continue;
 			}
 
-			const float weight1 = Vector2::Cross(edge2, toPFromV2) * invMagnitude;
-			if (weight1 < 0.f) {
+			if (pass == RasterPass::shadeEqualDepth && interpolatedZ != depth) {
 				continue;
 			}
 
-			const float weight2 = Vector2::Cross(edge0, toPFromV0) * invMagnitude;
-			if (weight2 < 0.f) {
+			if (pass != RasterPass::shadeEqualDepth) {
+				WriteDepth(px, py, interpolatedZ);
+			} else {
+				// The pixel now has its owner, a later triangle at exactly the same depth no longer equals it
+				WriteDepth(px, py, std::nextafter(interpolatedZ, 0.f));
+			}
+
+			if (pass != RasterPass::depthOnly) {
+				++pixelsWritten;
+				WritePixel(triangle, px, py, interpolatedZ);
+			}
+		}
+	}
+
+	m_PixelsTested.fetch_add(pixelsTested, std::memory_order_relaxed);
+	m_PixelsWritten.fetch_add(pixelsWritten, std::memory_order_relaxed);
+}
+
+template <dae::SoftwareRenderBackend::RasterPass pass>
+void dae::SoftwareRenderBackend::RenderTriangleBlocks(const TriangleSetup& triangle, int startX, int startY, int endX, int endY) {
+	// Same operations in the same order as AttributeSetup::Plane::At, so blocks and single pixels get the same depth
+	const auto evaluate = [](const AttributeSetup::Plane& plane, __m128 x, __m128 y) {
+		return _mm_add_ps(_mm_add_ps(_mm_set1_ps(plane.origin), _mm_mul_ps(_mm_set1_ps(plane.stepX), x)), _mm_mul_ps(_mm_set1_ps(plane.stepY), y));
+	};
+
+	// Lane offsets relative to the left pixel of the block
+	const __m128 laneX{ _mm_setr_ps(0.f, 1.f, 2.f, 3.f) };
+
+	const __m128 one{ _mm_set1_ps(1.f) };
+	const __m128 zero{ _mm_setzero_ps() };
+
+	// Edge function offsets of every lane relative to the top left pixel of the block, per block row
+	__m128i laneOffsets[3][BLOCK_HEIGHT]{};
+
+	for (int edge{}; edge < 3; ++edge) {
+		const int32_t stepX{ static_cast<int32_t>(triangle.edgeStepX[edge]) };
+		const int32_t stepY{ static_cast<int32_t>(triangle.edgeStepY[edge]) };
+
+		for (int row{}; row < BLOCK_HEIGHT; ++row) {
+			laneOffsets[edge][row] = _mm_setr_epi32(row * stepY, stepX + row * stepY, 2 * stepX + row * stepY, 3 * stepX + row * stepY);
+		}
+	}
+
+	// Rows of a block are loaded at once when the layout keeps them together
+	const bool contiguousRows{ m_Layout.HasContiguousQuads() };
+	constexpr int FULL_BLOCK_ROW{ (1 << BLOCK_WIDTH) - 1 };
+
+	uint64_t pixelsTested{};
+	uint64_t pixelsWritten{};
+	uint64_t blocksRejected{};
+	bool isRejected{ true };
+
+	// Walk the Hi-Z tiles first so whole tiles can be skipped without touching the depth buffer
+	const int hizStartX{ startX / HIZ_TILE_SIZE };
+	const int hizStartY{ startY / HIZ_TILE_SIZE };
+	const int hizEndX{ (endX - 1) / HIZ_TILE_SIZE };
+	const int hizEndY{ (endY - 1) / HIZ_TILE_SIZE };
+
+	for (int hizY{ hizStartY }; hizY <= hizEndY; ++hizY) {
+		for (int hizX{ hizStartX }; hizX <= hizEndX; ++hizX) {
+			const int hizIndex{ hizX + (hizY * m_HiZWidth) };
+
+			// Everything drawn in this tile so far is nearer than the triangle can get
+			if (m_HierarchicalDepthEnabled && triangle.nearestZ >= m_HiZMax[hizIndex]) {
+				++blocksRejected;
 				continue;
 			}
 
-			const Vector3 weightedPos = v0.position * weight0 + v1.position * weight1 + v2.position * weight2;
-			if (weightedPos.z >= m_pDepthBufferPixels[py + m_Height * px] || weightedPos.z < FLT_EPSILON) {
+			// And the other way around, the depth test can't fail
+			const bool depthAlwaysPasses{ m_HierarchicalDepthEnabled && triangle.farthestZ < m_HiZMin[hizIndex] };
+
+			// Which means nothing can be equal either
+			if (pass == RasterPass::shadeEqualDepth && depthAlwaysPasses) {
+				++blocksRejected;
 				continue;
 			}
 
-			const float interpolatedZ{ 1 / ((weight0 / v0.position.z) + (weight1 / v1.position.z) + (weight2 / v2.position.z)) };
-			if (interpolatedZ <= 0 || interpolatedZ > 1) {
+			isRejected = false;
+			ClearTile(hizX, hizY);
+			bool depthWritten{ false };
+
+			// Part of the tile inside the region
+			const int tileStartX{ std::max(hizX * HIZ_TILE_SIZE, startX) };
+			const int tileStartY{ std::max(hizY * HIZ_TILE_SIZE, startY) };
+			const int tileEndX{ std::min((hizX + 1) * HIZ_TILE_SIZE, endX) };
+			const int tileEndY{ std::min((hizY + 1) * HIZ_TILE_SIZE, endY) };
+
+			// Blocks are aligned to the screen, lanes outside of the region get masked out
+			for (int blockY{ tileStartY & ~(BLOCK_HEIGHT - 1) }; blockY < tileEndY; blockY += BLOCK_HEIGHT) {
+				for (int blockX{ tileStartX & ~(BLOCK_WIDTH - 1) }; blockX < tileEndX; blockX += BLOCK_WIDTH) {
+					int columnMask{};
+					for (int lane{}; lane < BLOCK_WIDTH; ++lane) {
+						if (blockX + lane >= tileStartX && blockX + lane < tileEndX) {
+							columnMask |= 1 << lane;
+						}
+					}
+
+					// The block origin can be far outside the triangle, clamping keeps the lanes in 32 bit without changing any sign
+					__m128i blockOrigin[3]{};
+					for (int edge{}; edge < 3; ++edge) {
+						const int64_t origin{ triangle.edgeOrigin[edge] + triangle.edgeStepX[edge] * blockX + triangle.edgeStepY[edge] * blockY };
+						blockOrigin[edge] = _mm_set1_epi32(static_cast<int32_t>(std::clamp<int64_t>(origin, -BLOCK_EDGE_CLAMP, BLOCK_EDGE_CLAMP)));
+					}
+
+					for (int row{}; row < BLOCK_HEIGHT; ++row) {
+						const int py{ blockY + row };
+						if (py < tileStartY || py >= tileEndY) {
+							continue;
+						}
+
+						const __m128i edge0{ _mm_add_epi32(blockOrigin[0], laneOffsets[0][row]) };
+						const __m128i edge1{ _mm_add_epi32(blockOrigin[1], laneOffsets[1][row]) };
+						const __m128i edge2{ _mm_add_epi32(blockOrigin[2], laneOffsets[2][row]) };
+
+						// Covered lanes have none of the sign bits set
+						const int outsideMask{ _mm_movemask_ps(_mm_castsi128_ps(_mm_or_si128(_mm_or_si128(edge0, edge1), edge2))) };
+						const int coverageMask{ ~outsideMask & columnMask };
+
+						if (coverageMask == 0) {
+							continue;
+						}
+
+						// Pixel positions relative to the anchor of the planes
+						const __m128 x{ _mm_add_ps(_mm_set1_ps(static_cast<float>(blockX - triangle.startX)), laneX) };
+						const __m128 y{ _mm_set1_ps(static_cast<float>(py - triangle.startY)) };
+
+						const __m128 interpolatedZ{ evaluate(triangle.depth, x, y) };
+						__m128 depthFailed{ _mm_or_ps(_mm_cmplt_ps(interpolatedZ, zero), _mm_cmpgt_ps(interpolatedZ, one)) };
+						__m128 depth{};
+
+						if (!depthAlwaysPasses) {
+
+							if (contiguousRows && columnMask == FULL_BLOCK_ROW) {
+								// The whole block row lies inside of the screen and next to each other in memory
+								depth = _mm_loadu_ps(m_pDepthBufferPixels + m_Layout.GetIndex(blockX, py));
+							} else {
+								// Only covered lanes are read, the others may lie outside of the screen
+								alignas(16) float depths[BLOCK_WIDTH]{};
+								for (int lane{}; lane < BLOCK_WIDTH; ++lane) {
+									if (coverageMask & (1 << lane)) {
+										depths[lane] = m_pDepthBufferPixels[m_Layout.GetIndex(blockX + lane, py)];
+									}
+								}
+
+								depth = _mm_load_ps(depths);
+							}
+
+							pixelsTested += std::popcount(static_cast<unsigned int>(~_mm_movemask_ps(depthFailed) & coverageMask));
+
+							if constexpr (pass != RasterPass::shadeEqualDepth) {
+								depthFailed = _mm_or_ps(depthFailed, _mm_cmpge_ps(interpolatedZ, depth));
+							}
+						}
+
+						if constexpr (pass == RasterPass::shadeEqualDepth) {
+							depthFailed = _mm_or_ps(depthFailed, _mm_cmpneq_ps(interpolatedZ, depth));
+						}
+
+						const int passMask{ ~_mm_movemask_ps(depthFailed) & coverageMask };
+
+						if (passMask == 0) {
+							continue;
+						}
+
+						alignas(16) float depths[BLOCK_WIDTH];
+						_mm_store_ps(depths, interpolatedZ);
+
+						if constexpr (pass != RasterPass::shadeEqualDepth) {
+							for (int lane{}; lane < BLOCK_WIDTH; ++lane) {
+								if (passMask & (1 << lane)) {
+									WriteDepth(blockX + lane, py, depths[lane]);
+								}
+							}
+
+							depthWritten = true;
+						} else {
+							// Same as for single pixels, only the first triangle at a depth shades the pixel
+							for (int lane{}; lane < BLOCK_WIDTH; ++lane) {
+								if (passMask & (1 << lane)) {
+									WriteDepth(blockX + lane, py, std::nextafter(depths[lane], 0.f));
+								}
+							}
+						}
+
+						if constexpr (pass != RasterPass::depthOnly) {
+							pixelsWritten += std::popcount(static_cast<unsigned int>(passMask));
+
+							// Shading only runs on the lanes that survived
+							WritePixels(triangle, blockX, py, passMask, depths);
+						}
+					}
+				}
+			}
+
+			if (depthWritten) {
+				UpdateHiZMax(hizX, hizY);
+			}
+		}
+	}
+
+	m_PixelsTested.fetch_add(pixelsTested, std::memory_order_relaxed);
+	m_PixelsWritten.fetch_add(pixelsWritten, std::memory_order_relaxed);
+	m_BlocksRejected.fetch_add(blocksRejected, std::memory_order_relaxed);
+
+	if (isRejected) {
+		m_TrianglesRejected.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+void dae::SoftwareRenderBackend::UpdateHiZMax(int hizX, int hizY) {
+	const int startX{ hizX * HIZ_TILE_SIZE };
+	const int startY{ hizY * HIZ_TILE_SIZE };
+	const int endX{ std::min(startX + HIZ_TILE_SIZE, m_Width) };
+	const int endY{ std::min(startY + HIZ_TILE_SIZE, m_Height) };
+
+	float maxDepth{};
+	for (int py{ startY }; py < endY; ++py) {
+		for (int px{ startX }; px < endX; ++px) {
+			maxDepth = std::max(maxDepth, m_pDepthBufferPixels[m_Layout.GetIndex(px, py)]);
+		}
+	}
+
+	m_HiZMax[hizX + (hizY * m_HiZWidth)] = maxDepth;
+}
+
+void dae::SoftwareRenderBackend::ClearTile(int hizX, int hizY) {
+	uint32_t& tileEpoch{ m_TileEpochs[hizX + (hizY * m_HiZWidth)] };
+	if (tileEpoch == m_FrameEpoch) {
+		return;
+	}
+
+	tileEpoch = m_FrameEpoch;
+
+	const int startX{ hizX * HIZ_TILE_SIZE };
+	const int startY{ hizY * HIZ_TILE_SIZE };
+	const int endX{ std::min(startX + HIZ_TILE_SIZE, m_Width) };
+	const int endY{ std::min(startY + HIZ_TILE_SIZE, m_Height) };
+
+	for (int py{ startY }; py < endY; ++py) {
+		for (int px{ startX }; px < endX; ++px) {
+			const size_t pixelIndex{ m_Layout.GetIndex(px, py) };
+
+			m_pDepthBufferPixels[pixelIndex] = FLT_MAX;
+			m_pBackBufferPixels[pixelIndex] = m_ClearColor;
+		}
+	}
+
+	if (m_DeferredShading) {
+		for (int py{ startY }; py < endY; ++py) {
+			for (int px{ startX }; px < endX; ++px) {
+				m_VisibilityBuffer[m_Layout.GetIndex(px, py)] = NO_TRIANGLE;
+			}
+		}
+	}
+}
+
+void dae::SoftwareRenderBackend::ClearTiles(int startX, int startY, int endX, int endY) {
+	for (int hizY{ startY / HIZ_TILE_SIZE }; hizY <= (endY - 1) / HIZ_TILE_SIZE; ++hizY) {
+		for (int hizX{ startX / HIZ_TILE_SIZE }; hizX <= (endX - 1) / HIZ_TILE_SIZE; ++hizX) {
+			ClearTile(hizX, hizY);
+		}
+	}
+}
+
+bool dae::SoftwareRenderBackend::IsTileCleared(int hizX, int hizY) const {
+	return m_TileEpochs[hizX + (hizY * m_HiZWidth)] == m_FrameEpoch;
+}
+
+void dae::SoftwareRenderBackend::ResolveColorBuffer() {
+	uint32_t* pSurfacePixels{ static_cast<uint32_t*>(m_pBackBuffer->pixels) };
+	const int surfaceWidth{ m_pBackBuffer->pitch / static_cast<int>(sizeof(uint32_t)) };
+
+	const bool isLinear{ m_Layout.GetType() == PixelLayout::Type::linear };
+
+	for (int hizY{}; hizY < m_HiZHeight; ++hizY) {
+		for (int hizX{}; hizX < m_HiZWidth; ++hizX) {
+			const bool isCleared{ IsTileCleared(hizX, hizY) };
+
+			// A linear color buffer already is the surface
+			if (isCleared && isLinear) {
 				continue;
 			}
 
-			const float interpolatedW{ 1 / ((weight0 / v0.position.w) + (weight1 / v1.position.w) + (weight2 / v2.position.w)) };
+			const int startX{ hizX * HIZ_TILE_SIZE };
+			const int startY{ hizY * HIZ_TILE_SIZE };
+			const int endX{ std::min(startX + HIZ_TILE_SIZE, m_Width) };
+			const int endY{ std::min(startY + HIZ_TILE_SIZE, m_Height) };
 
-			Vector2 uv = ((v0.uv / v0.position.w) * weight0 +
-										(v1.uv / v1.position.w) * weight1 +
-										(v2.uv / v2.position.w) * weight2) * interpolatedW;
+			for (int py{ startY }; py < endY; ++py) {
+				uint32_t* pSurfaceRow{ pSurfacePixels + (py * surfaceWidth) };
 
-			ColorRGB finalColor{};
+				// Nothing got drawn in untouched tiles, so they go straight to the surface as background
+				if (!isCleared) {
+					std::fill(pSurfaceRow + startX, pSurfaceRow + endX, m_ClearColor);
+					continue;
+				}
 
-			switch (m_ViewMode) {
-				case ViewMode::depthBuffer:
-				{
-					const float remapedInterpolatedZ{ Remap(interpolatedZ, 0.985f, 1.f) };
-					finalColor = { remapedInterpolatedZ, remapedInterpolatedZ, remapedInterpolatedZ };
-					break;
+				for (int px{ startX }; px < endX; ++px) {
+					pSurfaceRow[px] = m_pBackBufferPixels[m_Layout.GetIndex(px, py)];
 				}
+			}
+		}
+	}
+}
 
-				default:
-				{
-					const ColorRGB color{ mesh->GetDiffuse()->Sample(uv) };
+void dae::SoftwareRenderBackend::WriteDepth(int px, int py, float interpolatedZ) {
+	m_pDepthBufferPixels[m_Layout.GetIndex(px, py)] = interpolatedZ;
 
-					const Vector3 normal{ v0.normal * weight0 + v1.normal * weight1 + v2.normal * weight2 };
-					const Vector3 tangent{ v0.tangent * weight0 + v1.tangent * weight1 + v2.tangent * weight2 };
-					const Vector3 position{ v0.position * weight0 + v1.position * weight1 + v2.position * weight2 };
-					const Vector3 viewDirection{ v0.viewDirection * weight0 + v1.viewDirection * weight1 + v2.viewDirection * weight2 };
+	// The nearest depth of a tile can only go down, the farthest gets recalculated by the block rasterizer
+	float& hizMin{ m_HiZMin[(px / HIZ_TILE_SIZE) + ((py / HIZ_TILE_SIZE) * m_HiZWidth)] };
+	hizMin = std::min(hizMin, interpolatedZ);
+}
 
-					finalColor = PixelShading(mesh, { position.ToPoint4(), color, uv, normal.Normalized(), tangent.Normalized(), viewDirection.Normalized() });
-					break;
-				}
+void dae::SoftwareRenderBackend::WritePixel(const TriangleSetup& triangle, int px, int py, float interpolatedZ) {
+	const size_t pixelIndex{ m_Layout.GetIndex(px, py) };
+
+	// Deferred shading only remembers the visible triangle, its planes get evaluated again when shading
+	if (m_DeferredShading) {
+		m_VisibilityBuffer[pixelIndex] = triangle.id;
+		return;
+	}
+
+	m_pBackBufferPixels[pixelIndex] = PackColor(ShadeFragment(triangle, px, py, interpolatedZ));
+}
+
+void dae::SoftwareRenderBackend::WritePixels(const TriangleSetup& triangle, int blockX, int py, int laneMask, const float* pInterpolatedZ) {
+	if (m_DeferredShading) {
+		for (int lane{}; lane < BLOCK_WIDTH; ++lane) {
+			if (laneMask & (1 << lane)) {
+				m_VisibilityBuffer[m_Layout.GetIndex(blockX + lane, py)] = triangle.id;
 			}
+		}
+
+		return;
+	}
+
+	ColorRGB colors[BLOCK_WIDTH]{};
+	for (int lane{}; lane < BLOCK_WIDTH; ++lane) {
+		if (laneMask & (1 << lane)) {
+			colors[lane] = ShadeFragment(triangle, blockX + lane, py, pInterpolatedZ[lane]);
+		}
+	}
 
-			const ColorRGB ambient{ 0.025f, 0.025f, 0.025f };
-			finalColor = finalColor + ambient;
-			finalColor.MaxToOne();
+	uint32_t packedColors[BLOCK_WIDTH]{};
+	PackColors(colors, packedColors);
 
-			m_pDepthBufferPixels[py + m_Height * px] = interpolatedZ;
-			m_pBackBufferPixels[px + (py * m_Width)] = SDL_MapRGB(m_pBackBuffer->format,
-																														static_cast<uint8_t>(finalColor.r * 255),
-																														static_cast<uint8_t>(finalColor.g * 255),
-																														static_cast<uint8_t>(finalColor.b * 255));
+	for (int lane{}; lane < BLOCK_WIDTH; ++lane) {
+		if (laneMask & (1 << lane)) {
+			m_pBackBufferPixels[m_Layout.GetIndex(blockX + lane, py)] = packedColors[lane];
 		}
 	}
 }
 
-ColorRGB dae::SoftwareRenderBackend::PixelShading(const Mesh* mesh, const OutVertex& vertex) const {
-	const Vector3 lightDirection{ .577f, -.577f, .577f };
+void dae::SoftwareRenderBackend::ShadeVisibleRow(int py) {
+	uint64_t pixelsShaded{};
 
-	const float lightIntensity{ 7.f };
-	const float shininess{ 25.f };
+	// Pixels are shaded in groups as wide as a block, so their colors get packed together
+	for (int blockX{}; blockX < m_Width; blockX += BLOCK_WIDTH) {
+		// The visibility buffer of untouched tiles still holds an older frame
+		if (!IsTileCleared(blockX / HIZ_TILE_SIZE, py / HIZ_TILE_SIZE)) {
+			continue;
+		}
 
-	Vector3 normal{ vertex.normal };
+		ColorRGB colors[BLOCK_WIDTH]{};
+		int shadedMask{};
 
-	if (m_NormalMapEnabled) {
-		const Vector3 binormal{ Vector3::Cross(vertex.normal, vertex.tangent).Normalized() };
-		const Matrix tangentSpaceAxis{ vertex.tangent, binormal, vertex.normal, Vector3::Zero };
-		ColorRGB sampledNormalColor{ mesh->GetNormal()->Sample(vertex.uv) };
+		for (int lane{}; lane < BLOCK_WIDTH && blockX + lane < m_Width; ++lane) {
+			const int px{ blockX + lane };
+
+			const uint32_t triangleId{ m_VisibilityBuffer[m_Layout.GetIndex(px, py)] };
+			if (triangleId == NO_TRIANGLE) {
+				continue;
+			}
+
+			const TriangleSetup& triangle{ m_Triangles[triangleId] };
+
+			// The same plane the rasterizer evaluated, so this gives the depth that won the depth test
+			const float interpolatedZ{ triangle.depth.At(static_cast<float>(px - triangle.startX), static_cast<float>(py - triangle.startY)) };
+
+			colors[lane] = ShadeFragment(triangle, px, py, interpolatedZ);
+			shadedMask |= 1 << lane;
+		}
+
+		if (shadedMask == 0) {
+			continue;
+		}
+
+		pixelsShaded += std::popcount(static_cast<unsigned int>(shadedMask));
+
+		uint32_t packedColors[BLOCK_WIDTH]{};
+		PackColors(colors, packedColors);
+
+		for (int lane{}; lane < BLOCK_WIDTH; ++lane) {
+			if (shadedMask & (1 << lane)) {
+				m_pBackBufferPixels[m_Layout.GetIndex(blockX + lane, py)] = packedColors[lane];
+			}
+		}
+	}
+
+	m_PixelsShaded.fetch_add(pixelsShaded, std::memory_order_relaxed);
+}
 
-		Vector3 sampledNormal{ sampledNormalColor.r, sampledNormalColor.g, sampledNormalColor.b };
-		sampledNormal = 2.f * sampledNormal - Vector3{ 1.f, 1.f, 1.f };
+ColorRGB dae::SoftwareRenderBackend::ShadeFragment(const TriangleSetup& triangle, int px, int py, float interpolatedZ) const {
+	ColorRGB finalColor{};
 
-		normal = tangentSpaceAxis.TransformVector(sampledNormal).Normalized();
+	switch (m_ViewMode) {
+		case ViewMode::depthBuffer:
+		{
+			const float remapedInterpolatedZ{ Remap(interpolatedZ, 0.985f, 1.f) };
+			finalColor = { remapedInterpolatedZ, remapedInterpolatedZ, remapedInterpolatedZ };
+			break;
+		}
+
+		default:
+		{
+			const float x{ static_cast<float>(px - triangle.startX) };
+			const float y{ static_cast<float>(py - triangle.startY) };
+
+			AttributeSetup::Fragment fragment{ AttributeSetup::Interpolate(triangle.attributes, x, y, m_Varyings) };
+
+			// Quads are aligned to the screen, so neighbouring triangles agree on them
+			if (m_Varyings & AttributeSetup::uvVarying) {
+				const float quadX{ static_cast<float>((px & ~1) - triangle.startX) };
+				const float quadY{ static_cast<float>((py & ~1) - triangle.startY) };
+				AttributeSetup::GetTexCoordDerivatives(triangle.attributes, quadX, quadY, fragment.uvDdx, fragment.uvDdy);
+			}
+
+			finalColor = PixelShading(triangle.mesh, fragment);
+			break;
+		}
+	}
+
+	const ColorRGB ambient{ 0.025f, 0.025f, 0.025f };
+	finalColor = finalColor + ambient;
+	finalColor.MaxToOne();
+
+	return finalColor;
+}
+
+uint8_t dae::SoftwareRenderBackend::GetMaterialStreams() const {
+	if (m_ViewMode == ViewMode::depthBuffer) {
+		return 0;
 	}
 
+	const uint8_t normalStreams{ static_cast<uint8_t>(m_NormalMapEnabled ? Material::normalSpecularStream : 0) };
+
+	switch (m_ShadingMode) {
+		case ShadingMode::observedArea:
+			return normalStreams;
+
+		case ShadingMode::diffuse:
+			return Material::diffuseGlossStream;
+
+		default:
+			// The glossiness shares a stream with the diffuse color, the specular color with the normal
+			return Material::diffuseGlossStream | Material::normalSpecularStream;
+	}
+}
+
+uint8_t dae::SoftwareRenderBackend::GetVaryings() const {
+	if (m_ViewMode == ViewMode::depthBuffer) {
+		return 0;
+	}
+
+	// The normal map needs the uv and tangent of the fragment on top of its normal
+	const uint8_t normalVaryings{ static_cast<uint8_t>(m_NormalMapEnabled ?
+		AttributeSetup::normalVarying | AttributeSetup::tangentVarying | AttributeSetup::uvVarying : AttributeSetup::normalVarying) };
+
+	switch (m_ShadingMode) {
+		case ShadingMode::observedArea:
+			return normalVaryings;
+
+		case ShadingMode::diffuse:
+			return AttributeSetup::uvVarying;
+
+		default:
+			return normalVaryings | AttributeSetup::uvVarying | AttributeSetup::worldPositionVarying;
+	}
+}
+
+uint32_t dae::SoftwareRenderBackend::PackColor(const ColorRGB& color) const {
+	// Channels are truncated like a cast to uint8_t, after clamping them to the valid range
+	const uint32_t red{ static_cast<uint8_t>(std::clamp(color.r, 0.f, 1.f) * 255) };
+	const uint32_t green{ static_cast<uint8_t>(std::clamp(color.g, 0.f, 1.f) * 255) };
+	const uint32_t blue{ static_cast<uint8_t>(std::clamp(color.b, 0.f, 1.f) * 255) };
+
+	if (!m_CanPackColors) {
+		return SDL_MapRGB(m_pBackBuffer->format, static_cast<uint8_t>(red), static_cast<uint8_t>(green), static_cast<uint8_t>(blue));
+	}
+
+	return (red << m_RedShift) | (green << m_GreenShift) | (blue << m_BlueShift) | m_AlphaMask;
+}
+
+void dae::SoftwareRenderBackend::PackColors(const ColorRGB* colors, uint32_t* pPackedColors) const {
+	if (!m_CanPackColors) {
+		for (int lane{}; lane < BLOCK_WIDTH; ++lane) {
+			pPackedColors[lane] = PackColor(colors[lane]);
+		}
+
+		return;
+	}
+
+	static_assert(BLOCK_WIDTH == 4, "Colors are packed a SSE register at a time");
+
+	const __m128 zero{ _mm_setzero_ps() };
+	const __m128 one{ _mm_set1_ps(1.f) };
+	const __m128 scale{ _mm_set1_ps(255.f) };
+
+	// One channel of every color per register, clamped and truncated the same way PackColor does
+	const auto toChannel = [&](float channel0, float channel1, float channel2, float channel3) {
+		const __m128 channel{ _mm_setr_ps(channel0, channel1, channel2, channel3) };
+		return _mm_cvttps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(channel, zero), one), scale));
+	};
+
+	const __m128i red{ toChannel(colors[0].r, colors[1].r, colors[2].r, colors[3].r) };
+	const __m128i green{ toChannel(colors[0].g, colors[1].g, colors[2].g, colors[3].g) };
+	const __m128i blue{ toChannel(colors[0].b, colors[1].b, colors[2].b, colors[3].b) };
+
+	__m128i packed{ _mm_set1_epi32(static_cast<int32_t>(m_AlphaMask)) };
+	packed = _mm_or_si128(packed, _mm_sll_epi32(red, _mm_cvtsi32_si128(static_cast<int32_t>(m_RedShift))));
+	packed = _mm_or_si128(packed, _mm_sll_epi32(green, _mm_cvtsi32_si128(static_cast<int32_t>(m_GreenShift))));
+	packed = _mm_or_si128(packed, _mm_sll_epi32(blue, _mm_cvtsi32_si128(static_cast<int32_t>(m_BlueShift))));
+
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(pPackedColors), packed);
+}
+
+MaterialSample dae::SoftwareRenderBackend::SampleMaterial(const Mesh* mesh, const AttributeSetup::Fragment& fragment) const {
+	if (m_MaterialStreams == 0) {
+		return MaterialSample{};
+	}
+
+	if (const Material* pMaterial{ mesh->GetMaterial().get() }) {
+		return pMaterial->Sample(fragment.uv, fragment.uvDdx, fragment.uvDdy, m_Sampler, m_MaterialStreams);
+	}
+
+	// Maps that could not be baked, each one gets read on its own and a missing one keeps its default
+	MaterialSample material{};
+	const Texture* pDiffuse{ mesh->GetDiffuse().get() };
+	const Texture* pNormal{ mesh->GetNormal().get() };
+	const Texture* pGlossiness{ mesh->GetGlossiness().get() };
+	const Texture* pSpecular{ mesh->GetSpecular().get() };
+
+	if (m_MaterialStreams & Material::diffuseGlossStream) {
+		// Specular shading only reads the glossiness out of this stream
+		if (m_ShadingMode != ShadingMode::specular && pDiffuse) {
+			material.diffuse = pDiffuse->Sample(fragment.uv, fragment.uvDdx, fragment.uvDdy, m_Sampler);
+		}
+
+		if (m_ShadingMode != ShadingMode::diffuse && pGlossiness) {
+			material.glossiness = pGlossiness->Sample(fragment.uv, fragment.uvDdx, fragment.uvDdy, m_Sampler).r;
+		}
+	}
+
+	if (m_MaterialStreams & Material::normalSpecularStream) {
+		// Without a normal map the surface stays flat in tangent space
+		if (m_NormalMapEnabled) {
+			material.normal = pNormal ? pNormal->SampleNormal(fragment.uv, fragment.uvDdx, fragment.uvDdy, m_Sampler) : Vector3{ 0.f, 0.f, 1.f };
+		}
+
+		if (m_ShadingMode != ShadingMode::observedArea && pSpecular) {
+			material.specular = pSpecular->Sample(fragment.uv, fragment.uvDdx, fragment.uvDdy, m_Sampler);
+		}
+	}
+
+	return material;
+}
+
+Vector3 dae::SoftwareRenderBackend::GetShadingNormal(const AttributeSetup::Fragment& fragment, const MaterialSample& material) const {
+	if (!m_NormalMapEnabled) {
+		return fragment.normal;
+	}
+
+	const Vector3 binormal{ Vector3::Cross(fragment.normal, fragment.tangent).Normalized() };
+	const Matrix tangentSpaceAxis{ fragment.tangent, binormal, fragment.normal, Vector3::Zero };
+
+	return tangentSpaceAxis.TransformVector(material.normal).Normalized();
+}
+
+ColorRGB dae::SoftwareRenderBackend::PixelShading(const Mesh* mesh, const AttributeSetup::Fragment& fragment) const {
+	const Vector3 lightDirection{ .577f, -.577f, .577f };
+
+	const float lightIntensity{ 7.f };
+	const float shininess{ 25.f };
+
+	const MaterialSample material{ SampleMaterial(mesh, fragment) };
+
 	switch (m_ShadingMode) {
 		case dae::SoftwareRenderBackend::ShadingMode::observedArea: {
-			const float observedArea{ std::max(Vector3::Dot(normal, -lightDirection), 0.f) };
+			const float observedArea{ std::max(Vector3::Dot(GetShadingNormal(fragment, material), -lightDirection), 0.f) };
 			return { colors::White * observedArea };
 		}
 
 		case dae::SoftwareRenderBackend::ShadingMode::diffuse: {
-			return{ (lightIntensity * vertex.color) / static_cast<float>(M_PI) };
+			return{ (lightIntensity * material.diffuse) / static_cast<float>(M_PI) };
 		}
 
 		case dae::SoftwareRenderBackend::ShadingMode::specular: {
-			ColorRGB glossinessColor{ mesh->GetGlossiness()->Sample(vertex.uv) };
-			glossinessColor.MaxToOne();
+			const Vector3 normal{ GetShadingNormal(fragment, material) };
 
-			float glossiness{ glossinessColor.r * shininess };
-			const ColorRGB specularColor{ mesh->GetSpecular()->Sample(vertex.uv) };
+			const float glossiness{ material.glossiness * shininess };
 
 			const Vector3 reflect{ Vector3::Reflect(lightDirection, normal) };
 
-			const float angle{ std::max(Vector3::Dot(reflect, vertex.viewDirection), 0.f) };
+			const Vector3 viewDirection{ (m_CameraOrigin - fragment.worldPosition).Normalized() };
+			const float angle{ std::max(Vector3::Dot(reflect, viewDirection), 0.f) };
 			const float specReflection{ powf(angle, glossiness) };
 
-			return{ specReflection * specularColor };
+			return{ specReflection * material.specular };
 		}
 
 		default: {
-			ColorRGB color{ vertex.color };
+			const Vector3 normal{ GetShadingNormal(fragment, material) };
+
+			ColorRGB color{ material.diffuse };
 			color.MaxToOne();
 
 			const ColorRGB lambertDiffuse{ (lightIntensity * color) / static_cast<float>(M_PI) };
 			const float observedArea{ std::max(Vector3::Dot(normal, -lightDirection), 0.f) };
 
-			ColorRGB glossinessColor{ mesh->GetGlossiness()->Sample(vertex.uv) };
-			glossinessColor.MaxToOne();
-
-			float glossiness{ glossinessColor.r * shininess };
-			const ColorRGB specularColor{ mesh->GetSpecular()->Sample(vertex.uv) };
+			const float glossiness{ material.glossiness * shininess };
 
 			const Vector3 reflect{ Vector3::Reflect(lightDirection, normal) };
-			const float angle{ std::max(Vector3::Dot(reflect, vertex.viewDirection), 0.f) };
+			const Vector3 viewDirection{ (m_CameraOrigin - fragment.worldPosition).Normalized() };
+			const float angle{ std::max(Vector3::Dot(reflect, viewDirection), 0.f) };
 			const float specReflection{ powf(angle, glossiness) };
 
-			const ColorRGB phong{ specReflection * specularColor };
+			const ColorRGB phong{ specReflection * material.specular };
 
 			ColorRGB outColor{ (lambertDiffuse * observedArea) + phong };
 			outColor.MaxToOne();
@@ -381,6 +1557,20 @@ void dae::SoftwareRenderBackend::CycleShadingMode() {
 	}
 }
 
+void dae::SoftwareRenderBackend::SetTechnique(BaseEffect::TechniqueType technique) {
+	switch (technique) {
+		case BaseEffect::TechniqueType::Point:
+			m_Sampler = Texture::Sampler::Point;
+			break;
+		case BaseEffect::TechniqueType::Linear:
+			m_Sampler = Texture::Sampler::Linear;
+			break;
+		case BaseEffect::TechniqueType::Anisotropic:
+			m_Sampler = Texture::Sampler::Anisotropic;
+			break;
+	}
+}
+
 void dae::SoftwareRenderBackend::ToggleNormalMap() {
 	m_NormalMapEnabled = !m_NormalMapEnabled;
 
@@ -400,3 +1590,58 @@ void dae::SoftwareRenderBackend::ToggleBoundingBox() {
 		std::cout << "Hiding bounding box" << std::endl;
 	}
 }
+
+void dae::SoftwareRenderBackend::ToggleDeferredShading() {
+	m_DeferredShading = !m_DeferredShading;
+
+	if (m_DeferredShading) {
+		std::cout << "Enabled deferred shading" << std::endl;
+	} else {
+		std::cout << "Disabled deferred shading" << std::endl;
+	}
+}
+
+void dae::SoftwareRenderBackend::ToggleDepthPrepass() {
+	m_DepthPrepassEnabled = !m_DepthPrepassEnabled;
+
+	if (m_DepthPrepassEnabled) {
+		std::cout << "Enabled depth pre-pass" << std::endl;
+	} else {
+		std::cout << "Disabled depth pre-pass" << std::endl;
+	}
+}
+
+void dae::SoftwareRenderBackend::ToggleMeshletCulling() {
+	m_MeshletCullingEnabled = !m_MeshletCullingEnabled;
+
+	if (m_MeshletCullingEnabled) {
+		std::cout << "Enabled meshlet culling" << std::endl;
+	} else {
+		std::cout << "Disabled meshlet culling" << std::endl;
+	}
+}
+
+void dae::SoftwareRenderBackend::SetThreadCount(int threadCount) {
+	m_ThreadCount = std::max(threadCount, 1);
+
+	// A single thread keeps rasterizing triangles as they come in
+	if (m_ThreadCount > 1) {
+		m_pThreadPool = std::make_unique<ThreadPool>(m_ThreadCount);
+	} else {
+		m_pThreadPool.reset();
+	}
+
+	std::cout << "Software backend uses " << m_ThreadCount << " thread(s)" << std::endl;
+}
+
+int dae::SoftwareRenderBackend::GetThreadCount() const {
+	return m_ThreadCount;
+}
+
+void dae::SoftwareRenderBackend::SetHierarchicalDepthEnabled(bool enabled) {
+	m_HierarchicalDepthEnabled = enabled;
+}
+
+dae::SoftwareRenderBackend::Statistics dae::SoftwareRenderBackend::GetStatistics() const {
+	return { m_PixelsTested.load(), m_PixelsWritten.load(), m_PixelsShaded.load(), m_BlocksRejected.load(), m_TrianglesRejected.load(), m_TrianglesSubmitted, m_TrianglesClipped, m_VerticesTransformed.load(), m_VerticesShaded.load(), m_MeshletsCulled, m_MeshesReused };
+}
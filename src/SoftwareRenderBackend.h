@@ -3,12 +3,20 @@
 #include <thread>
 #include <cstdint>
 #include <vector>
+#include <memory>
+#include <atomic>
+#include <deque>
 
 #include "Camera.h"
 #include "Utils.h"
 #include "Texture.h"
 #include "AbstractRenderBackend.h"
 #include "Mesh.h"
+#include "ThreadPool.h"
+#include "PixelLayout.h"
+#include "VertexStage.h"
+#include "AttributeSetup.h"
+#include "Material.h"
 
 struct SDL_Window;
 struct SDL_Surface;
@@ -30,7 +38,35 @@ namespace dae
 			combined
 		};
 
-		SoftwareRenderBackend(SDL_Window* pWindow);
+		// Counters of the last rendered frame
+		struct Statistics {
+			// Covered pixels whose depth got compared against the depth buffer, Hi-Z tiles the triangle is entirely in front of skip the comparison
+			uint64_t pixelsTested;
+			// Pixels that passed the depth test
+			uint64_t pixelsWritten;
+			// Pixels that ran the pixel shader, once per screen pixel at most with deferred shading
+			uint64_t pixelsShaded;
+			// Hi-Z tiles skipped for a triangle without touching their pixels
+			uint64_t blocksRejected;
+			// Triangles of which every Hi-Z tile got skipped
+			uint64_t trianglesRejected;
+			// Triangles that survived culling and went on to clipping or the rasterizer
+			uint64_t trianglesSubmitted;
+			// Triangles that crossed the near or far plane or the guard band
+			uint64_t trianglesClipped;
+			// Vertices whose position got transformed
+			uint64_t verticesTransformed;
+			// Vertices used by a triangle that survived culling and not shaded in an earlier frame with the same world matrix
+			uint64_t verticesShaded;
+			// Meshlets rejected by their normal cone before any of their vertices got transformed
+			uint64_t meshletsCulled;
+			// Meshes that reused the vertex stage output of an earlier frame, their vertices don't count as transformed or shaded
+			uint64_t meshesReused;
+		};
+
+		// A thread count above 1 switches to the tile binned (sort-middle) renderer
+		// The layout is shared by the color and depth buffer, swizzled color gets resolved to the window at the end of a frame
+		SoftwareRenderBackend(SDL_Window* pWindow, int threadCount = 1, PixelLayout::Type layout = PixelLayout::Type::linear);
 		~SoftwareRenderBackend();
 
 		int GetWidth() const override;
@@ -40,13 +76,202 @@ namespace dae
 		void CycleShadingMode();
 		void ToggleNormalMap();
 		void ToggleBoundingBox();
+		void ToggleDeferredShading();
+		void ToggleDepthPrepass();
+		void ToggleMeshletCulling();
+
+		// Samples textures the way the DirectX backend's technique of the same type does
+		void SetTechnique(BaseEffect::TechniqueType technique);
+
+		void SetThreadCount(int threadCount);
+		int GetThreadCount() const;
+
+		void SetHierarchicalDepthEnabled(bool enabled);
+		Statistics GetStatistics() const;
 
 		void Render(const Camera& camera, std::vector<Mesh*>& meshes) override;
 	private:
-		void VertexTransformationFunction(const Camera& camera, Mesh* mesh) const;
-		void RenderMesh(const Camera& camera, const Mesh* mesh);
-		void RenderTriangle(const Camera& camera, const Mesh* mesh, const OutVertex& v0, const OutVertex& v1, const OutVertex& v2);
-		ColorRGB PixelShading(const Mesh* mesh, const OutVertex& vertex) const;
+		// What rasterizing a triangle does with the pixels that pass the depth test
+		enum class RasterPass {
+			// Depth test, depth write and shading (or a visibility buffer write)
+			shade,
+			// Depth test and depth write only, no attributes get interpolated
+			// Always targets the depth buffer and Hi-Z of the backend, at the size of the back buffer
+			depthOnly,
+			// Shading of the pixels whose depth equals the depth buffer, which the depth only pass already filled
+			// A shaded pixel moves its depth one float step nearer, so of triangles at exactly the same depth only the first one shades it
+			shadeEqualDepth
+		};
+
+		// Everything about a triangle that does not depend on the pixel being rasterized
+		struct TriangleSetup {
+			// Index in the triangles of the frame, only set when the triangle gets stored
+			uint32_t id;
+
+			const Mesh* mesh;
+
+			const OutVertex* v0;
+			const OutVertex* v1;
+			const OutVertex* v2;
+
+			// Fixed point edge functions, edge i lies opposite of vertex i
+			// The value at pixel (px, py) is edgeOrigin + edgeStepX * px + edgeStepY * py
+			// Values are biased by the fill rule, a pixel is covered when all three are >= 0
+			int64_t edgeOrigin[3];
+			int64_t edgeStepX[3];
+			int64_t edgeStepY[3];
+			int64_t edgeBias[3];
+
+			// Barycentric weights and depth as planes relative to (startX, startY)
+			// The ndc depth is linear in screen space, so the depth test and the depth buffer both take it straight from its plane
+			AttributeSetup::Plane weights[3];
+			AttributeSetup::Plane depth;
+
+			// Only set up when the triangle gets submitted, after its vertices got shaded
+			AttributeSetup::Planes attributes;
+
+			// Bounds of the depth values the triangle can produce
+			float nearestZ;
+			float farthestZ;
+
+			// Whether the edge functions fit the lanes of the block rasterizer
+			bool allowBlocks;
+
+			// Screen space bounding box, clamped to the screen
+			int startX;
+			int startY;
+			int endX;
+			int endY;
+		};
+
+		// Screen tiles used for binning, each tile is rasterized by a single thread
+		static constexpr int TILE_SIZE{ 64 };
+
+		// 28.4 fixed point screen coordinates for rasterization
+		static constexpr int SUBPIXEL_BITS{ 4 };
+		static constexpr int SUBPIXEL_SCALE{ 1 << SUBPIXEL_BITS };
+
+		// Screen coordinates (in pixels) beyond this can't be snapped to fixed point
+		static constexpr float FIXED_POINT_LIMIT{ static_cast<float>(1 << 22) };
+
+		// Pixel blocks tested at once by the SSE rasterizer, one lane per pixel
+		static constexpr int BLOCK_WIDTH{ 4 };
+		static constexpr int BLOCK_HEIGHT{ 2 };
+
+		// Covered edge values and lane offsets stay below the limit, other values get clamped to fit 32 bit lanes
+		static constexpr int64_t BLOCK_EDGE_LIMIT{ int64_t{ 1 } << 29 };
+		static constexpr int64_t BLOCK_EDGE_CLAMP{ int64_t{ 1 } << 30 };
+
+		// Size of the tiles keeping a nearest and farthest depth, divides TILE_SIZE so binned tiles own whole Hi-Z tiles
+		static constexpr int HIZ_TILE_SIZE{ 8 };
+
+		// Visibility buffer value of pixels without a triangle
+		static constexpr uint32_t NO_TRIANGLE{ UINT32_MAX };
+
+		// Relative margin on triangle depth bounds to stay conservative
+		static constexpr float HIZ_EPSILON{ 1e-5f };
+
+		// Pixels past the screen edges that still rasterize without clipping, keeps clipped vertices inside the fixed point range
+		static constexpr float GUARD_BAND{ FIXED_POINT_LIMIT / 2 };
+
+		// Clip planes in homogeneous space, a set bit in a clip code means the vertex lies outside that plane
+		enum ClipPlane : uint8_t {
+			nearPlane = 1 << 0,
+			farPlane = 1 << 1,
+			leftPlane = 1 << 2,
+			rightPlane = 1 << 3,
+			bottomPlane = 1 << 4,
+			topPlane = 1 << 5
+		};
+
+		static constexpr int CLIP_PLANE_COUNT{ 6 };
+
+		// Every plane can add at most one vertex to the polygon
+		static constexpr int MAX_CLIPPED_VERTICES{ 3 + CLIP_PLANE_COUNT };
+
+		// A triangle that survived culling, either set up for the rasterizer already or still to be clipped
+		struct CulledTriangle {
+			TriangleSetup setup;
+			uint32_t indices[3];
+			bool needsClipping;
+		};
+
+		// Vertex stage output of a mesh that only the software rasterizer needs, indexed like its out vertices
+		struct MeshVertices {
+			Mesh* pMesh;
+			VertexStage::Transform transform;
+
+			// What the output got computed for, nothing has to be redone as long as none of it changes
+			uint32_t worldMatrixVersion;
+			const Camera* pCamera;
+			uint32_t cameraVersion;
+			Mesh::CullMode cullMode;
+
+			// Set for a frame in which none of the above changed, the output of the last frame then gets drawn as it is
+			bool reused;
+
+			// Clip space positions and clip codes, the clip stage needs the positions from before the perspective divide
+			std::vector<Vector4> clipPositions;
+			std::vector<uint8_t> clipCodes;
+
+			// One bit per vertex, set for vertices of the surviving triangles so every one of them gets shaded exactly once
+			std::vector<uint64_t> shadedVertices;
+
+			// One bit per vertex whose attributes (uv and world space normal, tangent and position) are up to date
+			// They only depend on the world matrix, so vertices shaded in an earlier frame don't get shaded again
+			std::vector<uint64_t> worldShadedVertices;
+
+			// Meshlets facing the camera, only meshes with meshlets and a cull mode get culled per meshlet
+			// The positions of the vertices they use are the only ones that get transformed
+			bool cullsMeshlets;
+			std::vector<uint32_t> visibleMeshlets;
+			std::vector<uint64_t> transformedVertices;
+
+			// Surviving triangles in submission order, with the winding of strips already resolved
+			std::vector<CulledTriangle> triangles;
+		};
+
+		void VertexTransformationFunction(const Camera& camera, const std::vector<Mesh*>& meshes);
+		void CullMeshlets(MeshVertices& meshVertices);
+		// Writes the indices of the set bits inside of the chunk, returns how many there are
+		static size_t GetSetBits(const std::vector<uint64_t>& bits, const VertexStage::Chunk& chunk, uint32_t* pIndices);
+		void TransformChunk(const VertexStage::Chunk& chunk);
+		void CullTriangles(MeshVertices& meshVertices);
+		void CullTriangle(MeshVertices& meshVertices, uint32_t index0, uint32_t index1, uint32_t index2);
+		void ShadeChunk(const VertexStage::Chunk& chunk);
+		Vector4 ToScreenSpace(const Vector4& clipPosition) const;
+		uint8_t GetClipCode(const Vector4& clipPosition) const;
+		float GetClipDistance(const Vector4& clipPosition, int planeIndex) const;
+		void RenderMesh(const Camera& camera, MeshVertices& meshVertices);
+		void ClipTriangle(const MeshVertices& meshVertices, uint32_t index0, uint32_t index1, uint32_t index2);
+		void SubmitTriangle(const Mesh* mesh, const OutVertex& v0, const OutVertex& v1, const OutVertex& v2);
+		void SubmitTriangle(TriangleSetup& triangle);
+		bool SetupTriangle(const Mesh* mesh, const OutVertex& v0, const OutVertex& v1, const OutVertex& v2, TriangleSetup& triangle) const;
+		void BinTriangle(const TriangleSetup& triangle);
+		void RenderTile(size_t tileIndex, RasterPass pass);
+		void RenderTriangle(const TriangleSetup& triangle, int minX, int minY, int maxX, int maxY, RasterPass pass);
+		template <RasterPass pass>
+		void RenderTrianglePixels(const TriangleSetup& triangle, int startX, int startY, int endX, int endY);
+		template <RasterPass pass>
+		void RenderTriangleBlocks(const TriangleSetup& triangle, int startX, int startY, int endX, int endY);
+		void WriteDepth(int px, int py, float interpolatedZ);
+		void WritePixel(const TriangleSetup& triangle, int px, int py, float interpolatedZ);
+		// The lanes of a block row set in the mask, their colors get packed together
+		void WritePixels(const TriangleSetup& triangle, int blockX, int py, int laneMask, const float* pInterpolatedZ);
+		void ShadeVisibleRow(int py);
+		ColorRGB ShadeFragment(const TriangleSetup& triangle, int px, int py, float interpolatedZ) const;
+		uint8_t GetVaryings() const;
+		uint8_t GetMaterialStreams() const;
+		uint32_t PackColor(const ColorRGB& color) const;
+		void PackColors(const ColorRGB* colors, uint32_t* pPackedColors) const;
+		void UpdateHiZMax(int hizX, int hizY);
+		void ClearTile(int hizX, int hizY);
+		void ClearTiles(int startX, int startY, int endX, int endY);
+		bool IsTileCleared(int hizX, int hizY) const;
+		void ResolveColorBuffer();
+		MaterialSample SampleMaterial(const Mesh* mesh, const AttributeSetup::Fragment& fragment) const;
+		Vector3 GetShadingNormal(const AttributeSetup::Fragment& fragment, const MaterialSample& material) const;
+		ColorRGB PixelShading(const Mesh* mesh, const AttributeSetup::Fragment& fragment) const;
 
 		float Remap(float value, float newMin, float newMax) const;
 
@@ -57,13 +282,82 @@ namespace dae
 
 		SDL_Surface* m_pFrontBuffer{ nullptr };
 		SDL_Surface* m_pBackBuffer{ nullptr };
+
+		// Channel shifts of the back buffer format, resolved once so colors get packed without going through SDL_MapRGB
+		bool m_CanPackColors{ false };
+		uint32_t m_RedShift{};
+		uint32_t m_GreenShift{};
+		uint32_t m_BlueShift{};
+		uint32_t m_AlphaMask{};
+
+		// Pixels are addressed through the layout, which points straight at the back buffer when it is linear
+		PixelLayout m_Layout{};
 		uint32_t* m_pBackBufferPixels{};
+		std::vector<uint32_t> m_SwizzledColorBuffer{};
 
 		ViewMode m_ViewMode{ ViewMode::finalColor };
 		ShadingMode m_ShadingMode{ ShadingMode::combined };
 		bool m_NormalMapEnabled{ true };
 		bool m_ShowBoundingBox{ false };
+		bool m_DeferredShading{ false };
+		bool m_DepthPrepassEnabled{ false };
+		bool m_MeshletCullingEnabled{ true };
+		Texture::Sampler m_Sampler{ Texture::Sampler::Point };
+
+		// Set at the start of every frame for the fragments
+		uint8_t m_Varyings{};
+		uint8_t m_MaterialStreams{};
+		Vector3 m_CameraOrigin{};
 
 		float* m_pDepthBufferPixels{};
+
+		int m_ThreadCount{ 1 };
+		std::unique_ptr<ThreadPool> m_pThreadPool{ nullptr };
+
+		int m_TilesX{};
+		int m_TilesY{};
+
+		bool m_HierarchicalDepthEnabled{ true };
+
+		int m_HiZWidth{};
+		int m_HiZHeight{};
+		std::vector<float> m_HiZMin{};
+		std::vector<float> m_HiZMax{};
+
+		// Hi-Z tiles are also the unit of clearing, a tile is only cleared when a frame first touches it
+		// Tiles whose epoch lags behind the frame were not touched and get the background color when presenting
+		uint32_t m_FrameEpoch{};
+		std::vector<uint32_t> m_TileEpochs{};
+		uint32_t m_ClearColor{};
+
+		std::atomic<uint64_t> m_PixelsTested{};
+		std::atomic<uint64_t> m_PixelsWritten{};
+		std::atomic<uint64_t> m_PixelsShaded{};
+		std::atomic<uint64_t> m_BlocksRejected{};
+		std::atomic<uint64_t> m_TrianglesRejected{};
+		uint64_t m_TrianglesSubmitted{};
+		uint64_t m_TrianglesClipped{};
+		std::atomic<uint64_t> m_VerticesTransformed{};
+		std::atomic<uint64_t> m_VerticesShaded{};
+		uint64_t m_MeshletsCulled{};
+		uint64_t m_MeshesReused{};
+
+		// Size of the guard band in normalized device coordinates
+		float m_GuardBandX{};
+		float m_GuardBandY{};
+
+		// Every software rendered mesh of the current frame and the chunks their vertices got split into
+		std::vector<MeshVertices> m_MeshVertices{};
+		std::vector<VertexStage::Chunk> m_VertexChunks{};
+
+		// Triangle visible in every pixel, filled by the rasterizer and shaded afterwards with deferred shading
+		std::vector<uint32_t> m_VisibilityBuffer{};
+
+		// Vertices created by clipping, a deque keeps them in place for the binned triangles pointing at them
+		std::deque<OutVertex> m_ClippedVertices{};
+
+		// Triangles of the current frame (binned, deferred or pre-passed) and the indices of those overlapping each tile, in submission order
+		std::vector<TriangleSetup> m_Triangles{};
+		std::vector<std::vector<uint32_t>> m_TileBins{};
 	};
 }
@@ -1,18 +1,73 @@
 #include "Texture.h"
-#include "Vector2.h"
+#include "MathHelpers.h"
 #include <SDL_image.h>
+#include <cstring>
+#include <emmintrin.h>
 #include <iostream>
 
 namespace dae
 {
-	Texture::Texture(SDL_Surface* pSurface, ID3D11Device* pDevice) :
-		m_pSurfacePixels{ (uint32_t*)pSurface->pixels }, m_Width( pSurface->w ), m_Height( pSurface->h ), m_Format(pSurface->format), m_pSurface(pSurface)
+	Texture::Texture(SDL_Surface* pSurface, ID3D11Device* pDevice, PixelLayout::Type layout) :
+		m_Width( pSurface->w ), m_Height( pSurface->h )
+	{
+		// Whatever the file held becomes RGBA8 in memory order, which is also the format of the GPU texture
+		SDL_Surface* pConvertedSurface{ SDL_ConvertSurfaceFormat(pSurface, SDL_PIXELFORMAT_RGBA32, 0) };
+		SDL_FreeSurface(pSurface);
+
+		if (!pConvertedSurface) {
+			std::cout << "Failed to convert texture: " << SDL_GetError() << '\n';
+			return;
+		}
+
+		m_Texels.resize(static_cast<size_t>(m_Width) * m_Height);
+		for (int row{}; row < m_Height; ++row) {
+			const uint8_t* pRow{ static_cast<const uint8_t*>(pConvertedSurface->pixels) + static_cast<size_t>(row) * pConvertedSurface->pitch };
+			std::memcpy(m_Texels.data() + static_cast<size_t>(row) * m_Width, pRow, static_cast<size_t>(m_Width) * sizeof(uint32_t));
+		}
+
+		SDL_FreeSurface(pConvertedSurface);
+
+		BuildMipLevels();
+
+		if (pDevice) {
+			CreateResource(pDevice);
+		}
+
+		if (layout != PixelLayout::Type::linear) {
+			ApplyLayout(layout);
+		}
+	}
+
+	Texture::~Texture()
+	{
+		if (m_pResourceView) {
+			m_pResourceView->Release();
+		}
+
+		if (m_pResource) {
+			m_pResource->Release();
+		}
+	}
+
+	std::shared_ptr<Texture> Texture::LoadFromFile(const std::string& path, ID3D11Device* pDevice, PixelLayout::Type layout)
+	{
+		SDL_Surface* pSurface{ IMG_Load(path.c_str()) };
+
+		if (!pSurface) {
+			std::cout << "Failed to load texture " << path << ": " << IMG_GetError() << '\n';
+			return nullptr;
+		}
+
+		return std::make_shared<Texture>(pSurface, pDevice, layout);
+	}
+
+	void Texture::CreateResource(ID3D11Device* pDevice)
 	{
 		DXGI_FORMAT format = DXGI_FORMAT_R8G8B8A8_UNORM;
 		D3D11_TEXTURE2D_DESC desc{};
-		desc.Width = pSurface->w;
-		desc.Height = pSurface->h;
-		desc.MipLevels = 1;
+		desc.Width = static_cast<UINT>(m_Width);
+		desc.Height = static_cast<UINT>(m_Height);
+		desc.MipLevels = static_cast<UINT>(m_Levels.size());
 		desc.ArraySize = 1;
 		desc.Format = format;
 		desc.SampleDesc.Count = 1;
@@ -22,12 +77,16 @@ namespace dae
 		desc.CPUAccessFlags = 0;
 		desc.MiscFlags = 0;
 
-		D3D11_SUBRESOURCE_DATA initData{};
-		initData.pSysMem = m_pSurfacePixels;
-		initData.SysMemPitch = static_cast<UINT>(pSurface->pitch);
-		initData.SysMemSlicePitch = static_cast<UINT>(pSurface->h * pSurface->pitch);
+		std::vector<D3D11_SUBRESOURCE_DATA> initData(m_Levels.size());
+		for (size_t levelIndex{}; levelIndex < m_Levels.size(); ++levelIndex) {
+			const MipLevel& level{ m_Levels[levelIndex] };
+
+			initData[levelIndex].pSysMem = m_Texels.data() + level.offset;
+			initData[levelIndex].SysMemPitch = static_cast<UINT>(level.width * sizeof(uint32_t));
+			initData[levelIndex].SysMemSlicePitch = static_cast<UINT>(level.width * level.height * sizeof(uint32_t));
+		}
 
-		HRESULT hr = pDevice->CreateTexture2D(&desc, &initData, &m_pResource);
+		HRESULT hr = pDevice->CreateTexture2D(&desc, initData.data(), &m_pResource);
 
 		if (FAILED(hr)) {
 			std::cout << "Failed to create texture \n";
@@ -37,7 +96,7 @@ namespace dae
 		D3D11_SHADER_RESOURCE_VIEW_DESC SRVDesc{};
 		SRVDesc.Format = format;
 		SRVDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-		SRVDesc.Texture2D.MipLevels = 1;
+		SRVDesc.Texture2D.MipLevels = static_cast<UINT>(m_Levels.size());
 
 		hr = pDevice->CreateShaderResourceView(m_pResource, &SRVDesc, &m_pResourceView);
 
@@ -46,32 +105,289 @@ namespace dae
 		}
 	}
 
-	Texture::~Texture()
+	void Texture::ApplyLayout(PixelLayout::Type layout)
+	{
+		std::vector<uint32_t> texels{};
+
+		for (MipLevel& level : m_Levels) {
+			const MipLevel source{ level };
+
+			level.layout = PixelLayout{ layout, level.width, level.height };
+			level.offset = texels.size();
+			texels.resize(texels.size() + level.layout.GetSize());
+
+			for (int y{}; y < level.height; ++y) {
+				for (int x{}; x < level.width; ++x) {
+					texels[level.GetTexelIndex(x, y)] = m_Texels[source.GetTexelIndex(x, y)];
+				}
+			}
+		}
+
+		m_Texels = std::move(texels);
+		m_Layout = layout;
+	}
+
+	size_t Texture::GetPointTexelIndex(const Vector2& uv, const Vector2& ddx, const Vector2& ddy) const
+	{
+		// Nearest level, magnified (or no derivatives at all) takes the largest one
+		const float levelOfDetail{ GetLevelOfDetail(ddx, ddy) };
+		const int lastLevel{ static_cast<int>(m_Levels.size()) - 1 };
+		const int level{ levelOfDetail > 0.f ? std::min(static_cast<int>(levelOfDetail + 0.5f), lastLevel) : 0 };
+
+		return GetTexelIndex(m_Levels[level], uv);
+	}
+
+	void Texture::AddBilinear(const MipLevel& level, const Vector2& uv, float weight, Footprint& footprint) const
+	{
+		// Texel centers lie at half texel offsets, so the footprint starts at most one texel before the level
+		const float x{ (uv.x - std::floor(uv.x)) * level.width - 0.5f };
+		const float y{ (uv.y - std::floor(uv.y)) * level.height - 0.5f };
+
+		const float floorX{ std::floor(x) };
+		const float floorY{ std::floor(y) };
+
+		// The neighbours wrap around like the uv does
+		const int x0{ floorX < 0.f ? level.width - 1 : static_cast<int>(floorX) };
+		const int y0{ floorY < 0.f ? level.height - 1 : static_cast<int>(floorY) };
+		const int x1{ x0 + 1 < level.width ? x0 + 1 : 0 };
+		const int y1{ y0 + 1 < level.height ? y0 + 1 : 0 };
+
+		// The corner weights are built from the two fractions, so they always add up to exactly one
+		constexpr int weightOne{ 1 << 8 };
+		const int fractionX{ static_cast<int>((x - floorX) * weightOne + 0.5f) };
+		const int fractionY{ static_cast<int>((y - floorY) * weightOne + 0.5f) };
+		const int weight11{ (fractionX * fractionY + weightOne / 2) >> 8 };
+
+		footprint.quads[footprint.quadCount++] = {
+			{ level.GetTexelIndex(x0, y0), level.GetTexelIndex(x1, y0), level.GetTexelIndex(x0, y1), level.GetTexelIndex(x1, y1) },
+			{
+				static_cast<short>(weightOne - fractionX - fractionY + weight11),
+				static_cast<short>(fractionX - weight11),
+				static_cast<short>(fractionY - weight11),
+				static_cast<short>(weight11)
+			},
+			weight
+		};
+	}
+
+	void Texture::AddTrilinear(const Vector2& uv, float levelOfDetail, float weight, Footprint& footprint) const
+	{
+		const int lastLevel{ static_cast<int>(m_Levels.size()) - 1 };
+
+		// Magnified (or no derivatives at all), only the largest level
+		if (!(levelOfDetail > 0.f)) {
+			AddBilinear(m_Levels[0], uv, weight, footprint);
+			return;
+		}
+
+		if (levelOfDetail >= static_cast<float>(lastLevel)) {
+			AddBilinear(m_Levels[lastLevel], uv, weight, footprint);
+			return;
+		}
+
+		const int level{ static_cast<int>(levelOfDetail) };
+		const float fartherWeight{ levelOfDetail - static_cast<float>(level) };
+
+		AddBilinear(m_Levels[level], uv, weight * (1.f - fartherWeight), footprint);
+		AddBilinear(m_Levels[level + 1], uv, weight * fartherWeight, footprint);
+	}
+
+	void Texture::AddAnisotropic(const Vector2& uv, const Vector2& ddx, const Vector2& ddy, Footprint& footprint) const
+	{
+		// Lengths of both pixel steps in texels, the footprint stretches along the longer one
+		const float lengthX{ std::sqrt(Square(ddx.x * m_Width) + Square(ddx.y * m_Height)) };
+		const float lengthY{ std::sqrt(Square(ddy.x * m_Width) + Square(ddy.y * m_Height)) };
+		const float majorLength{ std::max(lengthX, lengthY) };
+		const float minorLength{ std::min(lengthX, lengthY) };
+
+		if (!(majorLength > 0.f)) {
+			AddBilinear(m_Levels[0], uv, 1.f, footprint);
+			return;
+		}
+
+		// One probe for every time the footprint is longer than wide, the level then follows from the shorter axis
+		const int probeCount{ minorLength * MAX_ANISOTROPY > majorLength ? static_cast<int>(std::ceil(majorLength / minorLength)) : MAX_ANISOTROPY };
+		const float levelOfDetail{ std::log2(majorLength / static_cast<float>(probeCount)) };
+
+		// Probes at the centers of equal pieces of the major axis, one pixel step long in total
+		const Vector2 axis{ lengthX >= lengthY ? ddx : ddy };
+		const float probeStep{ 1.f / static_cast<float>(probeCount) };
+
+		for (int probe{}; probe < probeCount; ++probe) {
+			const float offset{ (static_cast<float>(probe) + 0.5f) * probeStep - 0.5f };
+			AddTrilinear(uv + axis * offset, levelOfDetail, probeStep, footprint);
+		}
+	}
+
+	void Texture::GetFootprint(const Vector2& uv, const Vector2& ddx, const Vector2& ddy, Sampler sampler, Footprint& footprint) const
+	{
+		footprint.quadCount = 0;
+
+		if (m_Levels.empty()) {
+			return;
+		}
+
+		switch (sampler) {
+			case Sampler::Point: {
+				const size_t index{ GetPointTexelIndex(uv, ddx, ddy) };
+				footprint.quads[footprint.quadCount++] = { { index, index, index, index }, { 1 << 8, 0, 0, 0 }, 1.f };
+				break;
+			}
+
+			case Sampler::Linear:
+				AddTrilinear(uv, GetLevelOfDetail(ddx, ddy), 1.f, footprint);
+				break;
+
+			case Sampler::Anisotropic:
+				AddAnisotropic(uv, ddx, ddy, footprint);
+				break;
+		}
+	}
+
+	__m128 Texture::FilterQuad(const uint32_t* pTexels, const Footprint::Quad& quad)
 	{
-		m_pResourceView->Release();
-		m_pResource->Release();
-		SDL_FreeSurface(m_pSurface);
+		// Channels widened to 16 bits, the left texel of a row in the lower half and the right one in the upper half
+		const __m128i zero{ _mm_setzero_si128() };
+		const __m128i texels{ _mm_setr_epi32(static_cast<int>(pTexels[quad.indices[0]]), static_cast<int>(pTexels[quad.indices[1]]),
+			static_cast<int>(pTexels[quad.indices[2]]), static_cast<int>(pTexels[quad.indices[3]])) };
+		const __m128i top{ _mm_unpacklo_epi8(texels, zero) };
+		const __m128i bottom{ _mm_unpackhi_epi8(texels, zero) };
+
+		const short w00{ quad.weights[0] };
+		const short w10{ quad.weights[1] };
+		const short w01{ quad.weights[2] };
+		const short w11{ quad.weights[3] };
+		const __m128i topWeights{ _mm_setr_epi16(w00, w00, w00, w00, w10, w10, w10, w10) };
+		const __m128i bottomWeights{ _mm_setr_epi16(w01, w01, w01, w01, w11, w11, w11, w11) };
+
+		// A channel of 255 at the full weight still fits 16 bits unsigned, and so does any sum of the four products
+		__m128i sums{ _mm_add_epi16(_mm_mullo_epi16(top, topWeights), _mm_mullo_epi16(bottom, bottomWeights)) };
+		sums = _mm_add_epi16(sums, _mm_srli_si128(sums, 8));
+
+		const __m128 channels{ _mm_cvtepi32_ps(_mm_unpacklo_epi16(sums, zero)) };
+		return _mm_mul_ps(channels, _mm_set1_ps(1.f / (255.f * (1 << 8))));
 	}
 
-	std::shared_ptr<Texture> Texture::LoadFromFile(const std::string& path, ID3D11Device* pDevice)
+	ColorRGB Texture::Sample(const Vector2& uv, const Vector2& ddx, const Vector2& ddy, Sampler sampler) const
 	{
-		return std::make_shared<Texture>(IMG_Load(path.c_str()), pDevice);
+		if (m_Levels.empty()) {
+			return ColorRGB{};
+		}
+
+		if (sampler == Sampler::Point) {
+			return GetColor(GetPointTexelIndex(uv, ddx, ddy));
+		}
+
+		Footprint footprint;
+		GetFootprint(uv, ddx, ddy, sampler, footprint);
+
+		__m128 sum{ _mm_setzero_ps() };
+		for (int quadIndex{}; quadIndex < footprint.quadCount; ++quadIndex) {
+			const Footprint::Quad& quad{ footprint.quads[quadIndex] };
+			sum = _mm_add_ps(sum, _mm_mul_ps(FilterQuad(m_Texels.data(), quad), _mm_set1_ps(quad.weight)));
+		}
+
+		float channels[4];
+		_mm_storeu_ps(channels, sum);
+
+		return ColorRGB{ channels[0], channels[1], channels[2] };
 	}
 
-	ColorRGB Texture::Sample(const Vector2& uv) const
+	Vector3 Texture::SampleNormal(const Vector2& uv, const Vector2& ddx, const Vector2& ddy, Sampler sampler) const
 	{
-		// Wrap UV coordinates if they exceed [0, 1]
-		float u = uv.x - std::floor(uv.x);
-		float v = uv.y - std::floor(uv.y);
+		// The remap is linear, so remapping the filtered texels gives the same direction as filtering remapped ones
+		const ColorRGB color{ Sample(uv, ddx, ddy, sampler) };
+		return 2.f * Vector3{ color.r, color.g, color.b } - Vector3{ 1.f, 1.f, 1.f };
+	}
 
-		const size_t px{ static_cast<size_t>(u * m_Width) };
-		const size_t py{ static_cast<size_t>(v * m_Height) };
-		const uint32_t pixel{ m_pSurfacePixels[px + (py * m_Width)] };
+	void Texture::TraceSample(const Vector2& uv, const Vector2& ddx, const Vector2& ddy, Sampler sampler, std::vector<size_t>& texelIndices) const
+	{
+		if (m_Levels.empty()) {
+			return;
+		}
 
-		Uint8 r{}, g{}, b{};
-		SDL_GetRGB(pixel, m_Format, &r, &g, &b);
+		if (sampler == Sampler::Point) {
+			texelIndices.push_back(GetPointTexelIndex(uv, ddx, ddy));
+			return;
+		}
+
+		Footprint footprint;
+		GetFootprint(uv, ddx, ddy, sampler, footprint);
+
+		for (int quadIndex{}; quadIndex < footprint.quadCount; ++quadIndex) {
+			const Footprint::Quad& quad{ footprint.quads[quadIndex] };
+			texelIndices.insert(texelIndices.end(), std::begin(quad.indices), std::end(quad.indices));
+		}
+	}
+
+	bool Texture::HasSameLevels(const Texture& other) const
+	{
+		return m_Width == other.m_Width && m_Height == other.m_Height && m_Layout == other.m_Layout && m_Texels.size() == other.m_Texels.size();
+	}
+
+	const std::vector<uint32_t>& Texture::GetTexels() const
+	{
+		return m_Texels;
+	}
+
+	int Texture::GetLevelCount() const
+	{
+		return static_cast<int>(m_Levels.size());
+	}
+
+	PixelLayout::Type Texture::GetLayout() const
+	{
+		return m_Layout;
+	}
+
+	void Texture::BuildMipLevels()
+	{
+		m_Levels.push_back({ m_Width, m_Height, 0, PixelLayout{ PixelLayout::Type::linear, m_Width, m_Height } });
+
+		while (m_Levels.back().width > 1 || m_Levels.back().height > 1) {
+			const MipLevel source{ m_Levels.back() };
+			const int width{ std::max(source.width / 2, 1) };
+			const int height{ std::max(source.height / 2, 1) };
+			const MipLevel level{ width, height, source.offset + static_cast<size_t>(source.width) * source.height, PixelLayout{ PixelLayout::Type::linear, width, height } };
+
+			m_Levels.push_back(level);
+			m_Texels.resize(level.offset + static_cast<size_t>(level.width) * level.height);
+
+			for (int y{}; y < level.height; ++y) {
+				for (int x{}; x < level.width; ++x) {
+					// The last row or column of an odd sized level gets sampled twice
+					const size_t rows[2]{ static_cast<size_t>(std::min(2 * y, source.height - 1)), static_cast<size_t>(std::min(2 * y + 1, source.height - 1)) };
+					const size_t columns[2]{ static_cast<size_t>(std::min(2 * x, source.width - 1)), static_cast<size_t>(std::min(2 * x + 1, source.width - 1)) };
+
+					uint32_t channelSums[4]{};
+					for (size_t row : rows) {
+						for (size_t column : columns) {
+							const uint32_t texel{ m_Texels[source.offset + column + row * source.width] };
+
+							for (int channel{}; channel < 4; ++channel) {
+								channelSums[channel] += (texel >> (channel * 8)) & 0xFF;
+							}
+						}
+					}
+
+					uint32_t texel{};
+					for (int channel{}; channel < 4; ++channel) {
+						texel |= ((channelSums[channel] + 2) / 4) << (channel * 8);
+					}
+
+					m_Texels[level.offset + x + static_cast<size_t>(y) * level.width] = texel;
+				}
+			}
+		}
+	}
+
+	float Texture::GetLevelOfDetail(const Vector2& ddx, const Vector2& ddy) const
+	{
+		// The longest of the two pixel steps in texels, like the GPU picks its level
+		const float lengthX{ Square(ddx.x * m_Width) + Square(ddx.y * m_Height) };
+		const float lengthY{ Square(ddy.x * m_Width) + Square(ddy.y * m_Height) };
 
-		return ColorRGB{ r / 255.f, g / 255.f, b / 255.f };
+		return 0.5f * std::log2(std::max(lengthX, lengthY));
 	}
 
 	ID3D11ShaderResourceView* Texture::GetSRV() const {
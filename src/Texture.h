@@ -1,34 +1,175 @@
 #pragma once
 #include <SDL_surface.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
 #include <string>
+#include <vector>
 #include "ColorRGB.h"
+#include "PixelLayout.h"
+#include "Vector2.h"
+#include "Vector3.h"
 
 #include <d3d11.h>
 #include <memory>
+#include <xmmintrin.h>
 
 namespace dae
 {
-	struct Vector2;
-
 	class Texture
 	{
 	public:
-		Texture(SDL_Surface* pSurface, ID3D11Device* pDevice);
+		// The software counterparts of the samplers behind BaseEffect::TechniqueType, all of them wrap
+		enum class Sampler {
+			// Nearest texel of the nearest level, MIN_MAG_MIP_POINT
+			Point,
+			// Bilinear in the two nearest levels and blended between them, MIN_MAG_MIP_LINEAR
+			Linear,
+			// Trilinear probes spread along the longest axis of the pixel footprint, ANISOTROPIC
+			Anisotropic
+		};
+
+		// Probes of the anisotropic sampler, the same maximum as the AnisotropicSampler of the effect
+		static constexpr int MAX_ANISOTROPY{ 16 };
+
+		// The texels a sampler blends for one sample, as bilinear quads that get blended with each other in float
+		// Any texel array with the same levels and layout as the texture can be filtered with it, like the streams of a baked material
+		struct Footprint {
+			struct Quad {
+				// Top left, top right, bottom left and bottom right texel
+				size_t indices[4];
+				// 8 bit fixed point, they add up to exactly 256
+				short weights[4];
+				// Share of the quad in the sample
+				float weight;
+			};
+
+			// Two levels for every anisotropic probe
+			Quad quads[2 * MAX_ANISOTROPY];
+			int quadCount;
+		};
+
+		// Without a device the texels only live in memory, for the software renderer and the benchmarks
+		// The layout is how the software renderer stores every level, the GPU always gets scanlines
+		Texture(SDL_Surface* pSurface, ID3D11Device* pDevice, PixelLayout::Type layout = PixelLayout::Type::linear);
 		~Texture();
 
-		static std::shared_ptr<Texture> LoadFromFile(const std::string& path, ID3D11Device* pDevice);
+		// Null when the file can't be opened or read as an image
+		static std::shared_ptr<Texture> LoadFromFile(const std::string& path, ID3D11Device* pDevice, PixelLayout::Type layout = PixelLayout::Type::linear);
+
+		// Nearest texel of the largest level
 		ColorRGB Sample(const Vector2& uv) const;
+		// Normals get decoded from the RGBA8 texels of a normal map, remapped from [0, 1] to [-1, 1]
+		Vector3 SampleNormal(const Vector2& uv) const;
+
+		// The level of detail follows from how far the uv moves from one pixel to the next (ddx) and the one below (ddy)
+		ColorRGB Sample(const Vector2& uv, const Vector2& ddx, const Vector2& ddy, Sampler sampler) const;
+		Vector3 SampleNormal(const Vector2& uv, const Vector2& ddx, const Vector2& ddy, Sampler sampler) const;
+
+		// Index of every texel a sample reads, in the order it reads them, for measuring how well a layout caches
+		void TraceSample(const Vector2& uv, const Vector2& ddx, const Vector2& ddy, Sampler sampler, std::vector<size_t>& texelIndices) const;
+
+		// Point sampling gives a single quad with the full weight on its first texel
+		void GetFootprint(const Vector2& uv, const Vector2& ddx, const Vector2& ddy, Sampler sampler, Footprint& footprint) const;
+
+		// Blends the four RGBA8 texels of a quad in 8 bit fixed point with SSE
+		// The channels come back as floats in [0, 1], red in the lowest lane
+		static __m128 FilterQuad(const uint32_t* pTexels, const Footprint::Quad& quad);
+
+		// Same size and layout, so a texel index means the same texel in both
+		bool HasSameLevels(const Texture& other) const;
+		const std::vector<uint32_t>& GetTexels() const;
+
+		// Zero when the file could not be decoded, such a texture samples as black and its footprints stay empty
+		int GetLevelCount() const;
+		PixelLayout::Type GetLayout() const;
 
 		ID3D11ShaderResourceView* GetSRV() const;
 	private:
+		struct MipLevel {
+			int width;
+			int height;
+			// Index of the first texel of the level
+			size_t offset;
+			PixelLayout layout;
+
+			size_t GetTexelIndex(int x, int y) const
+			{
+				return offset + layout.GetIndex(x, y);
+			}
+		};
+
+		// Box filters every level down from the one above it, until a single texel is left
+		void BuildMipLevels();
+		void CreateResource(ID3D11Device* pDevice);
+		// Rearranges the texels of every level, swizzled levels get padded to whole tiles
+		void ApplyLayout(PixelLayout::Type layout);
+		float GetLevelOfDetail(const Vector2& ddx, const Vector2& ddy) const;
+		size_t GetTexelIndex(const MipLevel& level, const Vector2& uv) const;
+		size_t GetPointTexelIndex(const Vector2& uv, const Vector2& ddx, const Vector2& ddy) const;
+
+		// Append the quads of a footprint, weight is the share of the whole filter in the sample
+		void AddBilinear(const MipLevel& level, const Vector2& uv, float weight, Footprint& footprint) const;
+		void AddTrilinear(const Vector2& uv, float levelOfDetail, float weight, Footprint& footprint) const;
+		void AddAnisotropic(const Vector2& uv, const Vector2& ddx, const Vector2& ddy, Footprint& footprint) const;
+
+		ColorRGB GetColor(size_t index) const;
+
+		// Channel values as floats, the same values as dividing by 255 without the divide
+		static constexpr std::array<float, 256> UNORM8_TO_FLOAT{ [] {
+			std::array<float, 256> table{};
+			for (int value{}; value < 256; ++value) {
+				table[value] = value / 255.f;
+			}
+			return table;
+		}() };
 
 		ID3D11Texture2D* m_pResource{ nullptr };
 		ID3D11ShaderResourceView* m_pResourceView{ nullptr };
-		uint32_t* m_pSurfacePixels{ nullptr };
-		SDL_PixelFormat* m_Format{ nullptr };
-		SDL_Surface* m_pSurface{ nullptr };
+
+		// Decoded once at load as RGBA8, red in the lowest byte, the surface is freed after the upload
+		// Holds every mip level one after the other, the same pyramid gets uploaded to the GPU before the layout gets applied
+		std::vector<uint32_t> m_Texels{};
+		std::vector<MipLevel> m_Levels{};
+		PixelLayout::Type m_Layout{ PixelLayout::Type::linear };
 
 		int m_Width;
 		int m_Height;
 	};
-}
\ No newline at end of file
+
+	inline size_t Texture::GetTexelIndex(const MipLevel& level, const Vector2& uv) const
+	{
+		// Wrap UV coordinates if they exceed [0, 1]
+		const float u{ uv.x - std::floor(uv.x) };
+		const float v{ uv.y - std::floor(uv.y) };
+
+		// Coordinates just below a whole number wrap to 1 after rounding, which is the last texel as well
+		const int px{ std::min(static_cast<int>(u * level.width), level.width - 1) };
+		const int py{ std::min(static_cast<int>(v * level.height), level.height - 1) };
+
+		return level.GetTexelIndex(px, py);
+	}
+
+	inline ColorRGB Texture::GetColor(size_t index) const
+	{
+		const uint32_t texel{ m_Texels[index] };
+
+		return ColorRGB{ UNORM8_TO_FLOAT[texel & 0xFF], UNORM8_TO_FLOAT[(texel >> 8) & 0xFF], UNORM8_TO_FLOAT[(texel >> 16) & 0xFF] };
+	}
+
+	inline ColorRGB Texture::Sample(const Vector2& uv) const
+	{
+		if (m_Levels.empty()) {
+			return ColorRGB{};
+		}
+
+		return GetColor(GetTexelIndex(m_Levels[0], uv));
+	}
+
+	inline Vector3 Texture::SampleNormal(const Vector2& uv) const
+	{
+		const ColorRGB color{ Sample(uv) };
+		return 2.f * Vector3{ color.r, color.g, color.b } - Vector3{ 1.f, 1.f, 1.f };
+	}
+}
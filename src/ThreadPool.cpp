@@ -0,0 +1,92 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+namespace dae
+{
+	ThreadPool::ThreadPool(int threadCount)
+	{
+		const int workerCount{ std::max(threadCount, 1) - 1 };
+
+		m_Workers.reserve(workerCount);
+		for (int index{}; index < workerCount; ++index) {
+			m_Workers.emplace_back(&ThreadPool::WorkerLoop, this);
+		}
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard lock{ m_Mutex };
+			m_IsStopping = true;
+		}
+
+		m_WakeCondition.notify_all();
+
+		for (std::thread& worker : m_Workers) {
+			worker.join();
+		}
+	}
+
+	int ThreadPool::GetThreadCount() const {
+		return static_cast<int>(m_Workers.size()) + 1;
+	}
+
+	void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& task) {
+		// Not worth waking anyone up for
+		if (m_Workers.empty() || count <= 1) {
+			for (size_t index{}; index < count; ++index) {
+				task(index);
+			}
+
+			return;
+		}
+
+		{
+			std::lock_guard lock{ m_Mutex };
+			m_pTask = &task;
+			m_TaskCount = count;
+			m_NextTask = 0;
+			m_BusyWorkers = m_Workers.size();
+			++m_Generation;
+		}
+
+		m_WakeCondition.notify_all();
+
+		RunTasks();
+
+		std::unique_lock lock{ m_Mutex };
+		m_DoneCondition.wait(lock, [this] { return m_BusyWorkers == 0; });
+		m_pTask = nullptr;
+	}
+
+	void ThreadPool::WorkerLoop() {
+		uint64_t generation{};
+
+		while (true) {
+			{
+				std::unique_lock lock{ m_Mutex };
+				m_WakeCondition.wait(lock, [this, generation] { return m_IsStopping || m_Generation != generation; });
+
+				if (m_IsStopping) {
+					return;
+				}
+
+				generation = m_Generation;
+			}
+
+			RunTasks();
+
+			std::lock_guard lock{ m_Mutex };
+			if (--m_BusyWorkers == 0) {
+				m_DoneCondition.notify_one();
+			}
+		}
+	}
+
+	void ThreadPool::RunTasks() {
+		for (size_t index{ m_NextTask++ }; index < m_TaskCount; index = m_NextTask++) {
+			(*m_pTask)(index);
+		}
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+//Standard includes
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dae
+{
+	// A small persistent worker pool, the calling thread also takes part in every dispatch
+	class ThreadPool final
+	{
+	public:
+		// The thread count includes the calling thread, so a count of 1 spawns no workers
+		explicit ThreadPool(int threadCount);
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool(ThreadPool&&) noexcept = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+		ThreadPool& operator=(ThreadPool&&) noexcept = delete;
+
+		int GetThreadCount() const;
+
+		// Runs task(index) for every index in [0, count) and blocks until all of them are done
+		// Tasks are handed out one index at a time, dispatches must not be nested
+		void ParallelFor(size_t count, const std::function<void(size_t)>& task);
+	private:
+		void WorkerLoop();
+		void RunTasks();
+
+		std::vector<std::thread> m_Workers{};
+
+		std::mutex m_Mutex{};
+		std::condition_variable m_WakeCondition{};
+		std::condition_variable m_DoneCondition{};
+
+		const std::function<void(size_t)>* m_pTask{ nullptr };
+		size_t m_TaskCount{};
+		std::atomic<size_t> m_NextTask{};
+
+		size_t m_BusyWorkers{};
+		uint64_t m_Generation{};
+		bool m_IsStopping{ false };
+	};
+}
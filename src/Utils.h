@@ -1,5 +1,8 @@
 #pragma once
+#include <bit>
 #include <fstream>
+#include <iostream>
+#include <unordered_map>
 #include "Math.h"
 #include "Mesh.h"
 
@@ -7,7 +10,63 @@ namespace dae
 {
 	namespace Utils
 	{
-		//Just parses vertices and indices
+		// The position, texture coordinate and normal indices of a face corner, 0 when the corner has none
+		struct OBJVertexKey
+		{
+			size_t position;
+			size_t texCoord;
+			size_t normal;
+
+			bool operator==(const OBJVertexKey& other) const
+			{
+				return position == other.position && texCoord == other.texCoord && normal == other.normal;
+			}
+		};
+
+		struct OBJVertexKeyHash
+		{
+			size_t operator()(const OBJVertexKey& key) const
+			{
+				size_t hash{ std::hash<size_t>{}(key.position) };
+				hash ^= std::hash<size_t>{}(key.texCoord) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+				hash ^= std::hash<size_t>{}(key.normal) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+				return hash;
+			}
+		};
+
+		// The bits of the three floats of a position, texture coordinate or normal value
+		// Only the exact same value matches, apart from -0 and +0 which get stored as +0
+		struct OBJValueKey
+		{
+			uint32_t x;
+			uint32_t y;
+			uint32_t z;
+
+			OBJValueKey(float valueX, float valueY, float valueZ) :
+				x{ std::bit_cast<uint32_t>(valueX + 0.f) },
+				y{ std::bit_cast<uint32_t>(valueY + 0.f) },
+				z{ std::bit_cast<uint32_t>(valueZ + 0.f) }
+			{
+			}
+
+			bool operator==(const OBJValueKey& other) const
+			{
+				return x == other.x && y == other.y && z == other.z;
+			}
+		};
+
+		struct OBJValueKeyHash
+		{
+			size_t operator()(const OBJValueKey& key) const
+			{
+				size_t hash{ std::hash<uint32_t>{}(key.x) };
+				hash ^= std::hash<uint32_t>{}(key.y) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+				hash ^= std::hash<uint32_t>{}(key.z) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+				return hash;
+			}
+		};
+
+		//Just parses vertices and indices, corners sharing a position, uv and normal become one vertex
 #pragma warning(push)
 #pragma warning(disable : 4505) //Warning unreferenced local function
 		static bool ParseOBJ(const std::string& filename, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, bool flipAxisAndWinding = true)
@@ -23,6 +82,21 @@ namespace dae
 			vertices.clear();
 			indices.clear();
 
+			// Index of the vertex every distinct corner became
+			std::unordered_map<OBJVertexKey, uint32_t, OBJVertexKeyHash> uniqueVertices{};
+
+			// Exporters often write the same value under several indices (a normal per corner for example)
+			// Every index maps to the first one with exactly the same value, so those corners can still share a vertex
+			std::unordered_map<OBJValueKey, size_t, OBJValueKeyHash> firstValueIndices[3]{};
+			std::vector<size_t> positionIndices{};
+			std::vector<size_t> UVIndices{};
+			std::vector<size_t> normalIndices{};
+
+			const auto mergeValue = [](std::unordered_map<OBJValueKey, size_t, OBJValueKeyHash>& firstIndices, std::vector<size_t>& mergedIndices, float x, float y, float z)
+			{
+				mergedIndices.push_back(firstIndices.try_emplace(OBJValueKey{ x, y, z }, mergedIndices.size() + 1).first->second);
+			};
+
 			std::string sCommand;
 			// start a while iteration ending when the end of file is reached (ios::eof)
 			while (!file.eof())
@@ -41,6 +115,7 @@ namespace dae
 					file >> x >> y >> z;
 
 					positions.emplace_back(x, y, z);
+					mergeValue(firstValueIndices[0], positionIndices, x, y, z);
 				}
 				else if (sCommand == "vt")
 				{
@@ -48,6 +123,7 @@ namespace dae
 					float u, v;
 					file >> u >> v;
 					UVs.emplace_back(u, 1 - v);
+					mergeValue(firstValueIndices[1], UVIndices, u, v, 0.f);
 				}
 				else if (sCommand == "vn")
 				{
@@ -56,6 +132,7 @@ namespace dae
 					file >> x >> y >> z;
 
 					normals.emplace_back(x, y, z);
+					mergeValue(firstValueIndices[2], normalIndices, x, y, z);
 				}
 				else if (sCommand == "f")
 				{
@@ -65,16 +142,12 @@ namespace dae
 					//add the material index as attibute to the attribute array
 					//
 					// Faces or triangles
-					Vertex vertex{};
-					size_t iPosition, iTexCoord, iNormal;
-
 					uint32_t tempIndices[3]{};
 					for (size_t iFace = 0; iFace < 3; iFace++)
 					{
 						// OBJ format uses 1-based arrays
-						file >> iPosition;
-						vertex.position = positions.at(iPosition - 1);
-						vertex.color = { 1.f, 1.f, 1.f };
+						OBJVertexKey key{};
+						file >> key.position;
 
 						if ('/' == file.peek())//is next in buffer ==  '/' ?
 						{
@@ -83,8 +156,7 @@ namespace dae
 							if ('/' != file.peek())
 							{
 								// Optional texture coordinate
-								file >> iTexCoord;
-								vertex.uv = UVs.at(iTexCoord - 1);
+								file >> key.texCoord;
 							}
 
 							if ('/' == file.peek())
@@ -92,14 +164,33 @@ namespace dae
 								file.ignore();
 
 								// Optional vertex normal
-								file >> iNormal;
-								vertex.normal = normals[iNormal - 1];
+								file >> key.normal;
 							}
 						}
 
-						vertices.push_back(vertex);
-						tempIndices[iFace] = uint32_t(vertices.size()) - 1;
-						//indices.push_back(uint32_t(vertices.size()) - 1);
+						key.position = positionIndices.at(key.position - 1);
+						if (key.texCoord != 0)
+							key.texCoord = UVIndices.at(key.texCoord - 1);
+						if (key.normal != 0)
+							key.normal = normalIndices.at(key.normal - 1);
+
+						const auto [it, isNew] = uniqueVertices.try_emplace(key, static_cast<uint32_t>(vertices.size()));
+						if (isNew)
+						{
+							Vertex vertex{};
+							vertex.position = positions.at(key.position - 1);
+							vertex.color = { 1.f, 1.f, 1.f };
+
+							if (key.texCoord != 0)
+								vertex.uv = UVs.at(key.texCoord - 1);
+
+							if (key.normal != 0)
+								vertex.normal = normals.at(key.normal - 1);
+
+							vertices.push_back(vertex);
+						}
+
+						tempIndices[iFace] = it->second;
 					}
 
 					indices.push_back(tempIndices[0]);
@@ -118,7 +209,7 @@ namespace dae
 				file.ignore(1000, '\n');
 			}
 
-			//Cheap Tangent Calculations
+			//Cheap Tangent Calculations, summed over every triangle sharing a vertex
 			for (uint32_t i = 0; i < indices.size(); i += 3)
 			{
 				uint32_t index0 = indices[i];
@@ -0,0 +1,333 @@
+#include "VertexStage.h"
+
+//Standard includes
+#include <algorithm>
+
+//Project includes
+#include "Quantization.h"
+
+//External includes
+#include <emmintrin.h>
+
+namespace dae
+{
+	namespace
+	{
+		// Four vectors, one component per register and one vertex per lane
+		struct Vector3x4 {
+			__m128 x;
+			__m128 y;
+			__m128 z;
+		};
+
+		// Matrix rows broadcast to every lane
+		struct MatrixX4 {
+			__m128 data[4][4];
+
+			explicit MatrixX4(const Matrix& matrix)
+			{
+				for (int row{}; row < 4; ++row) {
+					for (int column{}; column < 4; ++column) {
+						data[row][column] = _mm_set1_ps(matrix[row][column]);
+					}
+				}
+			}
+
+			// Same order of operations as Matrix::TransformVector
+			__m128 TransformVector(const Vector3x4& v, int column) const
+			{
+				return _mm_add_ps(_mm_add_ps(_mm_mul_ps(data[0][column], v.x), _mm_mul_ps(data[1][column], v.y)), _mm_mul_ps(data[2][column], v.z));
+			}
+
+			// Same order of operations as Matrix::TransformPoint
+			__m128 TransformPoint(const Vector3x4& p, int column) const
+			{
+				return _mm_add_ps(TransformVector(p, column), data[3][column]);
+			}
+		};
+
+		// Same order of operations as Vector3::Normalized
+		Vector3x4 Normalized(const Vector3x4& v)
+		{
+			const __m128 magnitude{ _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(v.x, v.x), _mm_mul_ps(v.y, v.y)), _mm_mul_ps(v.z, v.z))) };
+			return { _mm_div_ps(v.x, magnitude), _mm_div_ps(v.y, magnitude), _mm_div_ps(v.z, magnitude) };
+		}
+
+		constexpr size_t LANE_COUNT{ 4 };
+
+		Vector3x4 Load(const std::vector<float>& x, const std::vector<float>& y, const std::vector<float>& z, size_t index)
+		{
+			return { _mm_loadu_ps(x.data() + index), _mm_loadu_ps(y.data() + index), _mm_loadu_ps(z.data() + index) };
+		}
+
+		// Uv, normal and tangent of a vertex in whichever format the mesh keeps them
+		struct VertexAttributes {
+			const VertexStreams& streams;
+			bool compact;
+
+			explicit VertexAttributes(const Mesh& mesh) :
+				streams{ mesh.GetVertexStreams() },
+				compact{ mesh.GetVertexFormat() == BaseEffect::VertexFormat::Compact }
+			{
+			}
+
+			Vector2 GetTexCoord(uint32_t index) const
+			{
+				return compact ? Quantization::DecodeTexCoord(streams.texCoords[index], streams.texCoordOffset, streams.texCoordScale) : streams.uvs[index];
+			}
+
+			Vector3 GetNormal(uint32_t index) const
+			{
+				return compact ? Quantization::DecodeOctahedral(streams.normals[index]) : Vector3{ streams.normalX[index], streams.normalY[index], streams.normalZ[index] };
+			}
+
+			Vector3 GetTangent(uint32_t index) const
+			{
+				return compact ? Quantization::DecodeOctahedral(streams.tangents[index]) : Vector3{ streams.tangentX[index], streams.tangentY[index], streams.tangentZ[index] };
+			}
+		};
+
+		// Same order of operations as Quantization::DecodeOctahedral
+		Vector3x4 DecodeOctahedral(const std::vector<uint32_t>& packed, const uint32_t* pIndices)
+		{
+			const __m128i values{ _mm_setr_epi32(static_cast<int>(packed[pIndices[0]]), static_cast<int>(packed[pIndices[1]]), static_cast<int>(packed[pIndices[2]]), static_cast<int>(packed[pIndices[3]])) };
+
+			// Sign extended low and high halves
+			const __m128 scale{ _mm_set1_ps(1.f / Quantization::SNORM16_MAX) };
+			const __m128 x{ _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(values, 16), 16)), scale) };
+			const __m128 y{ _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(values, 16)), scale) };
+
+			const __m128 signMask{ _mm_set1_ps(-0.f) };
+			const __m128 z{ _mm_sub_ps(_mm_sub_ps(_mm_set1_ps(1.f), _mm_andnot_ps(signMask, x)), _mm_andnot_ps(signMask, y)) };
+
+			// The fold is never negative, so its sign bit can simply be replaced by the one of x and y
+			const __m128 fold{ _mm_max_ps(_mm_sub_ps(_mm_setzero_ps(), z), _mm_setzero_ps()) };
+			return {
+				_mm_sub_ps(x, _mm_or_ps(fold, _mm_and_ps(signMask, x))),
+				_mm_sub_ps(y, _mm_or_ps(fold, _mm_and_ps(signMask, y))),
+				z
+			};
+		}
+
+		// Vertices that survived culling are scattered over the streams
+		Vector3x4 Gather(const std::vector<float>& x, const std::vector<float>& y, const std::vector<float>& z, const uint32_t* pIndices)
+		{
+			const uint32_t i0{ pIndices[0] };
+			const uint32_t i1{ pIndices[1] };
+			const uint32_t i2{ pIndices[2] };
+			const uint32_t i3{ pIndices[3] };
+
+			return {
+				_mm_setr_ps(x[i0], x[i1], x[i2], x[i3]),
+				_mm_setr_ps(y[i0], y[i1], y[i2], y[i3]),
+				_mm_setr_ps(z[i0], z[i1], z[i2], z[i3])
+			};
+		}
+	}
+
+	namespace
+	{
+		// Clip space and screen space positions of four vertices at once
+		struct PositionTransform {
+			MatrixX4 worldViewProjection;
+
+			__m128 width;
+			__m128 height;
+			__m128 one{ _mm_set1_ps(1.f) };
+			__m128 two{ _mm_set1_ps(2.f) };
+
+			explicit PositionTransform(const VertexStage::Transform& transform) :
+				worldViewProjection{ transform.worldViewProjection },
+				width{ _mm_set1_ps(transform.width) },
+				height{ _mm_set1_ps(transform.height) }
+			{
+			}
+
+			void Transform(const Vector3x4& position, const size_t(&vertexIndices)[LANE_COUNT], OutVertex* pOutVertices, Vector4* pClipPositions) const
+			{
+				const __m128 clipX{ worldViewProjection.TransformPoint(position, 0) };
+				const __m128 clipY{ worldViewProjection.TransformPoint(position, 1) };
+				const __m128 clipZ{ worldViewProjection.TransformPoint(position, 2) };
+				const __m128 clipW{ worldViewProjection.TransformPoint(position, 3) };
+
+				// Perspective divide and viewport mapping, like ToScreenSpace
+				const __m128 screenX{ _mm_mul_ps(_mm_div_ps(_mm_add_ps(_mm_div_ps(clipX, clipW), one), two), width) };
+				const __m128 screenY{ _mm_mul_ps(_mm_div_ps(_mm_sub_ps(one, _mm_div_ps(clipY, clipW)), two), height) };
+				const __m128 screenZ{ _mm_div_ps(clipZ, clipW) };
+				const __m128 inverseW{ _mm_div_ps(one, clipW) };
+
+				// Back to one struct per vertex for the rasterizer
+				alignas(16) float lanes[8][LANE_COUNT];
+
+				const __m128 results[8]{ clipX, clipY, clipZ, clipW, screenX, screenY, screenZ, inverseW };
+				for (int result{}; result < 8; ++result) {
+					_mm_store_ps(lanes[result], results[result]);
+				}
+
+				for (size_t lane{}; lane < LANE_COUNT; ++lane) {
+					pClipPositions[vertexIndices[lane]] = { lanes[0][lane], lanes[1][lane], lanes[2][lane], lanes[3][lane] };
+					pOutVertices[vertexIndices[lane]].position = { lanes[4][lane], lanes[5][lane], lanes[6][lane], lanes[7][lane] };
+				}
+			}
+		};
+	}
+
+	Vector4 VertexStage::ToScreenSpace(const Vector4& clipPosition, float width, float height)
+	{
+		Vector4 position{ clipPosition };
+
+		position.x /= position.w;
+		position.y /= position.w;
+		position.z /= position.w;
+		position.w = 1 / position.w;
+
+		// Convert from ndc to screenspace position
+		position.x = ((position.x + 1) / 2) * width;
+		position.y = ((1 - position.y) / 2) * height;
+
+		return position;
+	}
+
+	void VertexStage::TransformPositionsScalar(const Mesh& mesh, const Transform& transform, OutVertex* pOutVertices, Vector4* pClipPositions, size_t begin, size_t end)
+	{
+		for (size_t index{ begin }; index < end; ++index) {
+			const Vector4 clipPosition{ transform.worldViewProjection.TransformPoint(mesh.GetPosition(static_cast<uint32_t>(index)).ToPoint4()) };
+
+			pClipPositions[index] = clipPosition;
+			pOutVertices[index].position = ToScreenSpace(clipPosition, transform.width, transform.height);
+		}
+	}
+
+	void VertexStage::TransformPositionsSimd(const Mesh& mesh, const Transform& transform, OutVertex* pOutVertices, Vector4* pClipPositions, size_t begin, size_t end)
+	{
+		const VertexStreams& streams{ mesh.GetVertexStreams() };
+		const PositionTransform positionTransform{ transform };
+
+		size_t index{ begin };
+
+		for (; index + LANE_COUNT <= end; index += LANE_COUNT) {
+			const size_t vertexIndices[LANE_COUNT]{ index, index + 1, index + 2, index + 3 };
+			positionTransform.Transform(Load(streams.positionX, streams.positionY, streams.positionZ, index), vertexIndices, pOutVertices, pClipPositions);
+		}
+
+		// Leftover vertices that don't fill a register
+		TransformPositionsScalar(mesh, transform, pOutVertices, pClipPositions, index, end);
+	}
+
+	void VertexStage::TransformPositionsScalar(const Mesh& mesh, const Transform& transform, OutVertex* pOutVertices, Vector4* pClipPositions, const uint32_t* pIndices, size_t count)
+	{
+		for (size_t indexIndex{}; indexIndex < count; ++indexIndex) {
+			TransformPositionsScalar(mesh, transform, pOutVertices, pClipPositions, pIndices[indexIndex], pIndices[indexIndex] + size_t{ 1 });
+		}
+	}
+
+	void VertexStage::TransformPositionsSimd(const Mesh& mesh, const Transform& transform, OutVertex* pOutVertices, Vector4* pClipPositions, const uint32_t* pIndices, size_t count)
+	{
+		const VertexStreams& streams{ mesh.GetVertexStreams() };
+		const PositionTransform positionTransform{ transform };
+
+		size_t indexIndex{};
+
+		for (; indexIndex + LANE_COUNT <= count; indexIndex += LANE_COUNT) {
+			const uint32_t* pLaneIndices{ pIndices + indexIndex };
+			const size_t vertexIndices[LANE_COUNT]{ pLaneIndices[0], pLaneIndices[1], pLaneIndices[2], pLaneIndices[3] };
+			positionTransform.Transform(Gather(streams.positionX, streams.positionY, streams.positionZ, pLaneIndices), vertexIndices, pOutVertices, pClipPositions);
+		}
+
+		TransformPositionsScalar(mesh, transform, pOutVertices, pClipPositions, pIndices + indexIndex, count - indexIndex);
+	}
+
+	void VertexStage::ShadeVerticesScalar(const Mesh& mesh, const Transform& transform, OutVertex* pOutVertices, const uint32_t* pIndices, size_t count)
+	{
+		const VertexAttributes attributes{ mesh };
+
+		for (size_t indexIndex{}; indexIndex < count; ++indexIndex) {
+			const uint32_t vertexIndex{ pIndices[indexIndex] };
+			OutVertex& outVertex{ pOutVertices[vertexIndex] };
+
+			outVertex.uv = attributes.GetTexCoord(vertexIndex);
+			outVertex.normal = transform.world.TransformVector(attributes.GetNormal(vertexIndex)).Normalized();
+			outVertex.tangent = transform.world.TransformVector(attributes.GetTangent(vertexIndex)).Normalized();
+			outVertex.worldPosition = transform.world.TransformPoint(mesh.GetPosition(vertexIndex));
+		}
+	}
+
+	void VertexStage::ShadeVerticesSimd(const Mesh& mesh, const Transform& transform, OutVertex* pOutVertices, const uint32_t* pIndices, size_t count)
+	{
+		const VertexStreams& streams{ mesh.GetVertexStreams() };
+		const VertexAttributes attributes{ mesh };
+		const MatrixX4 world{ transform.world };
+
+		size_t indexIndex{};
+
+		for (; indexIndex + LANE_COUNT <= count; indexIndex += LANE_COUNT) {
+			const uint32_t* pLaneIndices{ pIndices + indexIndex };
+
+			const Vector3x4 position{ Gather(streams.positionX, streams.positionY, streams.positionZ, pLaneIndices) };
+			const Vector3x4 normal{ attributes.compact ? DecodeOctahedral(streams.normals, pLaneIndices) : Gather(streams.normalX, streams.normalY, streams.normalZ, pLaneIndices) };
+			const Vector3x4 tangent{ attributes.compact ? DecodeOctahedral(streams.tangents, pLaneIndices) : Gather(streams.tangentX, streams.tangentY, streams.tangentZ, pLaneIndices) };
+
+			const Vector3x4 worldNormal{ Normalized({ world.TransformVector(normal, 0), world.TransformVector(normal, 1), world.TransformVector(normal, 2) }) };
+			const Vector3x4 worldTangent{ Normalized({ world.TransformVector(tangent, 0), world.TransformVector(tangent, 1), world.TransformVector(tangent, 2) }) };
+			const Vector3x4 worldPosition{ world.TransformPoint(position, 0), world.TransformPoint(position, 1), world.TransformPoint(position, 2) };
+
+			alignas(16) float lanes[9][LANE_COUNT];
+
+			const __m128 results[9]{
+				worldNormal.x, worldNormal.y, worldNormal.z,
+				worldTangent.x, worldTangent.y, worldTangent.z,
+				worldPosition.x, worldPosition.y, worldPosition.z
+			};
+
+			for (int result{}; result < 9; ++result) {
+				_mm_store_ps(lanes[result], results[result]);
+			}
+
+			for (size_t lane{}; lane < LANE_COUNT; ++lane) {
+				OutVertex& outVertex{ pOutVertices[pLaneIndices[lane]] };
+
+				outVertex.uv = attributes.GetTexCoord(pLaneIndices[lane]);
+				outVertex.normal = { lanes[0][lane], lanes[1][lane], lanes[2][lane] };
+				outVertex.tangent = { lanes[3][lane], lanes[4][lane], lanes[5][lane] };
+				outVertex.worldPosition = { lanes[6][lane], lanes[7][lane], lanes[8][lane] };
+			}
+		}
+
+		ShadeVerticesScalar(mesh, transform, pOutVertices, pIndices + indexIndex, count - indexIndex);
+	}
+
+	void VertexStage::TransformScalar(const Mesh& mesh, const Transform& transform, OutVertex* pOutVertices, Vector4* pClipPositions, size_t begin, size_t end)
+	{
+		TransformPositionsScalar(mesh, transform, pOutVertices, pClipPositions, begin, end);
+
+		for (size_t index{ begin }; index < end; ++index) {
+			const uint32_t vertexIndex{ static_cast<uint32_t>(index) };
+			ShadeVerticesScalar(mesh, transform, pOutVertices, &vertexIndex, 1);
+		}
+	}
+
+	void VertexStage::TransformSimd(const Mesh& mesh, const Transform& transform, OutVertex* pOutVertices, Vector4* pClipPositions, size_t begin, size_t end)
+	{
+		TransformPositionsSimd(mesh, transform, pOutVertices, pClipPositions, begin, end);
+
+		// Every vertex gets shaded, a batch at a time
+		constexpr size_t BATCH_SIZE{ 256 };
+		uint32_t indices[BATCH_SIZE];
+
+		for (size_t batchBegin{ begin }; batchBegin < end; batchBegin += BATCH_SIZE) {
+			const size_t batchSize{ std::min(BATCH_SIZE, end - batchBegin) };
+			for (size_t index{}; index < batchSize; ++index) {
+				indices[index] = static_cast<uint32_t>(batchBegin + index);
+			}
+
+			ShadeVerticesSimd(mesh, transform, pOutVertices, indices, batchSize);
+		}
+	}
+
+	void VertexStage::AppendChunks(size_t meshIndex, size_t vertexCount, std::vector<Chunk>& chunks)
+	{
+		for (size_t begin{}; begin < vertexCount; begin += CHUNK_SIZE) {
+			chunks.push_back({ meshIndex, begin, std::min(begin + CHUNK_SIZE, vertexCount) });
+		}
+	}
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+//Standard includes
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//Project includes
+#include "Mesh.h"
+#include "Matrix.h"
+#include "Vector3.h"
+#include "Vector4.h"
+
+namespace dae
+{
+	// Transforms mesh vertices for the software rasterizer
+	// Out vertices hold the screen space position (x, y), the ndc depth and 1 / w of the clip space position
+	namespace VertexStage
+	{
+		struct Transform {
+			Matrix world;
+			Matrix worldViewProjection;
+			Vector3 cameraOrigin;
+
+			// Viewport size in pixels
+			float width;
+			float height;
+		};
+
+		// A range of vertices of one mesh, the unit of work handed to the thread pool
+		struct Chunk {
+			size_t meshIndex;
+			size_t begin;
+			size_t end;
+		};
+
+		// Large enough to amortize the dispatch, a multiple of the SIMD width so only the last chunk of a mesh has a scalar tail
+		// and of 64 so chunks never share a word of a per vertex bitset
+		constexpr size_t CHUNK_SIZE{ 4096 };
+
+		// The SIMD stage does the same operations in the same order as the scalar one, so the results are identical
+		// unless the compiler fuses multiplies and adds, which is why they are only guaranteed to match within this relative error
+		constexpr float MAX_RELATIVE_ERROR{ 1e-5f };
+
+		// Perspective divide and viewport mapping of a clip space position, w becomes 1 / w
+		Vector4 ToScreenSpace(const Vector4& clipPosition, float width, float height);
+
+		// The stage runs in two steps, so attributes only get computed for vertices of triangles that survive culling
+		// Positions: clip space position and the screen space position of the out vertex
+		// Shading: uv and the world space normal, tangent and position of the out vertex
+		// None of it depends on the camera, so it stays valid for as long as the world matrix does
+
+		// Reference implementations, one vertex at a time
+		void TransformPositionsScalar(const Mesh& mesh, const Transform& transform, OutVertex* pOutVertices, Vector4* pClipPositions, size_t begin, size_t end);
+		void ShadeVerticesScalar(const Mesh& mesh, const Transform& transform, OutVertex* pOutVertices, const uint32_t* pIndices, size_t count);
+
+		// Four vertices per iteration with SSE from the vertex streams of the mesh, the rest goes through the scalar path
+		void TransformPositionsSimd(const Mesh& mesh, const Transform& transform, OutVertex* pOutVertices, Vector4* pClipPositions, size_t begin, size_t end);
+
+		// Positions of the given vertices only, for meshes of which some meshlets got culled
+		void TransformPositionsScalar(const Mesh& mesh, const Transform& transform, OutVertex* pOutVertices, Vector4* pClipPositions, const uint32_t* pIndices, size_t count);
+		void TransformPositionsSimd(const Mesh& mesh, const Transform& transform, OutVertex* pOutVertices, Vector4* pClipPositions, const uint32_t* pIndices, size_t count);
+		void ShadeVerticesSimd(const Mesh& mesh, const Transform& transform, OutVertex* pOutVertices, const uint32_t* pIndices, size_t count);
+
+		// Both steps for every vertex in the range
+		void TransformScalar(const Mesh& mesh, const Transform& transform, OutVertex* pOutVertices, Vector4* pClipPositions, size_t begin, size_t end);
+		void TransformSimd(const Mesh& mesh, const Transform& transform, OutVertex* pOutVertices, Vector4* pClipPositions, size_t begin, size_t end);
+
+		// Splits the vertices of a mesh into chunks that can be transformed independently
+		void AppendChunks(size_t meshIndex, size_t vertexCount, std::vector<Chunk>& chunks);
+	}
+}
@@ -11,6 +11,7 @@
 #include "Utils.h"
 #include "MeshEffect.h"
 #include "Texture.h"
+#include "Benchmark.h"
 
 using namespace dae;
 
@@ -24,6 +25,7 @@ static void PrintControls() {
 	std::cout << "[Key bindings - Shared]" << '\n';
 	std::cout << "    [F1] Toggle Rasterizer Mode (Directx/Software)" << '\n';
 	std::cout << "    [F2] Toggle Vehicle Rotation (ON/OFF)" << '\n';
+	std::cout << "    [F4] Cycle Sampler State (POINT/LINEAR/ANISOTROPIC)" << '\n';
 	std::cout << "    [F9] Cycle CullMode (BACK/FRONT/NONE)" << '\n';
 	std::cout << "    [F10] Toggle Uniform ClearColor (ON/OFF)" << '\n';
 	std::cout << "    [F11] Toggle Print FPS (ON/OFF)" << '\n';
@@ -31,7 +33,6 @@ static void PrintControls() {
 
 	std::cout << "[Key bindings - Directx]" << '\n';
 	std::cout << "    [F3] Toggle FireFX (ON/OFF)" << '\n';
-	std::cout << "    [F4] Cycle Sampler State (POINT/LINEAR/ANISOTROPIC)" << '\n';
 	std::cout << '\n';
 
 	std::cout << "[Key bindings - Software]" << '\n';
@@ -39,14 +40,26 @@ static void PrintControls() {
 	std::cout << "    [F6] Toggle NormalMap (ON/OFF)" << '\n';
 	std::cout << "    [F7] Toggle DepthBuffer Visualization (ON/OFF)" << '\n';
 	std::cout << "    [F8] Toggle BoundingBox Visualization (ON/OFF)" << '\n';
+	std::cout << "    [Z] Toggle Depth Pre-pass (ON/OFF)" << '\n';
+	std::cout << "    [X] Toggle Meshlet Culling (ON/OFF)" << '\n';
+	std::cout << "    [C] Toggle Deferred Shading (ON/OFF)" << '\n';
 	std::cout << '\n';
 }
 
 int main(int argc, char* args[])
 {
-	//Unreferenced parameters
-	(void)argc;
-	(void)args;
+	// Micro benchmarks run without a window, the frame checks open a hidden one of their own
+	if (argc > 1 && std::string{ args[1] } == "--benchmark") {
+		Benchmark::RunDepthLayouts();
+		Benchmark::RunVertexStage();
+		Benchmark::RunAttributeSetup();
+		Benchmark::RunTextureSampling();
+		Benchmark::RunTextureLayouts();
+		Benchmark::RunMaterialSampling();
+		Benchmark::RunVertexScaling();
+		Benchmark::RunFrameChecks();
+		return 0;
+	}
 
 	//Create window + surfaces
 	SDL_Init(SDL_INIT_VIDEO);
@@ -72,7 +85,7 @@ int main(int argc, char* args[])
 
 	// Create the renderers
 	DirectXRenderBackend* directXBackend = new DirectXRenderBackend(pWindow);
-	SoftwareRenderBackend* softwareBackend = new SoftwareRenderBackend(pWindow);
+	SoftwareRenderBackend* softwareBackend = new SoftwareRenderBackend(pWindow, static_cast<int>(std::thread::hardware_concurrency()));
 
 	// Set the colors
 	directXBackend->SetBackgroundColor(directXColor);
@@ -86,6 +99,14 @@ int main(int argc, char* args[])
 
 	std::shared_ptr<Texture> fireDiffuse{ Texture::LoadFromFile("resources/fireFX_diffuse.png", directXBackend->GetDevice()) };
 
+	// LoadFromFile already said which one is missing
+	if (!vehicleDiffuse || !vehicleNormal || !vehicleGloss || !vehicleSpecular || !fireDiffuse) {
+		delete directXBackend;
+		delete softwareBackend;
+		ShutDown(pWindow);
+		return 1;
+	}
+
 	// Create the scene / renderer
 	const auto pTimer = new Timer();
 	Renderer* pRenderer = new Renderer(directXBackend);
@@ -103,14 +124,16 @@ int main(int argc, char* args[])
 	Utils::ParseOBJ("resources/vehicle.obj", vehicleVertices, vehicleIndices);
 	Utils::ParseOBJ("resources/fireFX.obj", fireVertices, fireIndices);
 
-	std::shared_ptr<MeshEffect> vehicleEffect = std::make_shared<MeshEffect>(directXBackend->GetDevice(), L"resources/PostCol3D.fx");
+	std::shared_ptr<MeshEffect> vehicleEffect = std::make_shared<MeshEffect>(directXBackend->GetDevice(), L"resources/PostCol3D.fx", BaseEffect::VertexFormat::Compact);
 	std::shared_ptr<FireMeshEffect> fireEffect = std::make_shared<FireMeshEffect>(directXBackend->GetDevice(), L"resources/Fire3D.fx");
 
-	Mesh vehicleMesh{ Mesh::PrimitiveTopology::TriangleList, std::move(vehicleVertices), std::move(vehicleIndices), vehicleEffect };
+	Mesh vehicleMesh{ Mesh::PrimitiveTopology::TriangleList, std::move(vehicleVertices), std::move(vehicleIndices), vehicleEffect, BaseEffect::VertexFormat::Compact };
 	vehicleMesh.SetDiffuse(vehicleDiffuse);
 	vehicleMesh.SetNormal(vehicleNormal);
 	vehicleMesh.SetGlossiness(vehicleGloss);
 	vehicleMesh.SetSpecular(vehicleSpecular);
+	vehicleMesh.BuildMeshlets();
+	vehicleMesh.BakeMaterial();
 	meshes.push_back(&vehicleMesh);
 
 	Mesh fireMesh{ Mesh::PrimitiveTopology::TriangleList, std::move(fireVertices), std::move(fireIndices), fireEffect };
@@ -161,7 +184,9 @@ int main(int argc, char* args[])
 				}
 
 				if (e.key.keysym.scancode == SDL_SCANCODE_F4) {
+					// Both backends sample with the same technique, so switching between them keeps the quality
 					directXBackend->SwitchTechnique();
+					softwareBackend->SetTechnique(directXBackend->GetTechnique());
 				}
 
 				if (e.key.keysym.scancode == SDL_SCANCODE_F5) {
@@ -180,6 +205,18 @@ int main(int argc, char* args[])
 					softwareBackend->ToggleBoundingBox();
 				}
 
+				if (e.key.keysym.scancode == SDL_SCANCODE_Z) {
+					softwareBackend->ToggleDepthPrepass();
+				}
+
+				if (e.key.keysym.scancode == SDL_SCANCODE_X) {
+					softwareBackend->ToggleMeshletCulling();
+				}
+
+				if (e.key.keysym.scancode == SDL_SCANCODE_C) {
+					softwareBackend->ToggleDeferredShading();
+				}
+
 				if (e.key.keysym.scancode == SDL_SCANCODE_F9) {
 					// Switch cullmode for all meshes
 					for (Mesh* mesh : meshes) {
@@ -229,7 +266,17 @@ int main(int argc, char* args[])
 		if (printTimer >= 1.f && printFps)
 		{
 			printTimer = 0.f;
-			std::cout << "dFPS: " << pTimer->GetdFPS() << std::endl;
+			std::cout << "dFPS: " << pTimer->GetdFPS() << ", meshes culled: " << pRenderer->GetCulledMeshCount() << std::endl;
+
+			if (!isDirectX) {
+				const SoftwareRenderBackend::Statistics statistics{ softwareBackend->GetStatistics() };
+				std::cout << "Pixels depth tested: " << statistics.pixelsTested << ", written: " << statistics.pixelsWritten << ", shaded: " << statistics.pixelsShaded
+					<< " (Hi-Z rejected " << statistics.blocksRejected << " tiles, " << statistics.trianglesRejected << " triangles)"
+					<< ", triangles: " << statistics.trianglesSubmitted << " (clipped " << statistics.trianglesClipped << ")"
+					<< ", vertices shaded: " << statistics.verticesShaded << " of " << statistics.verticesTransformed
+					<< ", meshlets culled: " << statistics.meshletsCulled
+					<< ", meshes reused: " << statistics.meshesReused << std::endl;
+			}
 		}
 	}
 	pTimer->Stop();